@@ -17,6 +17,39 @@ extern "C" {
 
 #include "lexer.def"
 
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif // __AVX2__ || __SSE2__
+
+#if LEXER_SUPPORT_PIPELINE || LEXER_SUPPORT_FILE_SET
+#include <pthread.h>
+#endif // LEXER_SUPPORT_PIPELINE || LEXER_SUPPORT_FILE_SET
+
+#if LEXER_SUPPORT_PIPELINE
+#include <sched.h>
+#endif // LEXER_SUPPORT_PIPELINE
+
+#if LEXER_SUPPORT_FILE_SET
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+# if LEXER_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+# endif // LEXER_USE_IO_URING
+
+// `syscall` and `MAP_POPULATE` need _DEFAULT_SOURCE, which the libc only sets on its own when not compiling
+// with a strict `-std=c11`. without it, file sets fall back to reader threads
+# if LEXER_USE_IO_URING && defined( __NR_io_uring_setup ) && ( defined( _DEFAULT_SOURCE ) || defined( _BSD_SOURCE ) )
+#define LEXER_HAS_IO_URING 1
+# else
+#define LEXER_HAS_IO_URING 0
+# endif // LEXER_USE_IO_URING && __NR_io_uring_setup && ( _DEFAULT_SOURCE || _BSD_SOURCE )
+#endif // LEXER_SUPPORT_FILE_SET
+
     static size_t match_any( const char* str, const char* options ) {
         const char* p = options;
         while ( *p ) {
@@ -26,7 +59,7 @@ extern "C" {
             while ( *p && *p != ' ' ) { p++; }
             size_t length = p - start;
 
-            if ( length > 0 && strncmp( str, start, length ) == 0 )
+            if ( length > 0 && memcmp( str, start, length ) == 0 )
                 return length;
         }
         return 0;
@@ -99,51 +132,171 @@ extern "C" {
     # undef LEXER_KEYWORD
     };
 
+    // sized by the longest fixed string any token parser compares against the source
+    // sized by the longest symbol of each list (plus its terminator), so the lengths are known at compile time
+    // and nothing has to be computed lazily by whichever thread lexes first
+    typedef union {
+    # define LEXER_OP(sym, name) char name[sizeof(sym)];
+        LEXER_OPERATOR_LIST
+    # undef LEXER_OP
+    } lexer_longest_operator_t;
+
+    typedef union {
+    # define LEXER_PUNCT(sym, name) char name[sizeof(sym)];
+        LEXER_PUNCTUATION_LIST
+    # undef LEXER_PUNCT
+    } lexer_longest_punctuation_t;
+
+    typedef union {
+    # define LEXER_KEYWORD(sym, name) char name[sizeof(sym)];
+        LEXER_KEYWORD_LIST
+    # undef LEXER_KEYWORD
+    } lexer_longest_keyword_t;
+
+#define LEXER_MAX_OPERATOR_LENGTH    ( sizeof( lexer_longest_operator_t ) - 1 )
+#define LEXER_MAX_PUNCTUATION_LENGTH ( sizeof( lexer_longest_punctuation_t ) - 1 )
+#define LEXER_MAX_KEYWORD_LENGTH     ( sizeof( lexer_longest_keyword_t ) - 1 )
+
+    typedef union {
+        lexer_longest_operator_t operators;
+        lexer_longest_punctuation_t punctuation;
+        lexer_longest_keyword_t keywords;
+        char line_comment[sizeof( LEXER_LINE_COMMENT_STRING )];
+        char multiline_comment_open[sizeof( LEXER_MULTILINE_COMMENT_OPEN )];
+        char multiline_comment_close[sizeof( LEXER_MULTILINE_COMMENT_CLOSE )];
+        char string_delimiters[sizeof( LEXER_STRING_DELIMITERS )];
+        char hex_prefixes[sizeof( LEXER_HEX_PREFIXES )];
+        char hex_suffixes[sizeof( LEXER_HEX_SUFFIXES )];
+        char oct_prefixes[sizeof( LEXER_OCT_PREFIXES )];
+        char oct_suffixes[sizeof( LEXER_OCT_SUFFIXES )];
+        char bin_prefixes[sizeof( LEXER_BIN_PREFIXES )];
+        char bin_suffixes[sizeof( LEXER_BIN_SUFFIXES )];
+        char float_suffixes[sizeof( LEXER_FLOAT_SUFFIXES )];
+        char escape_digits[17];
+    } lexer_longest_prefix_t;
+
+    // widest block the structural pre-pass loads at once
+#define LEXER_SIMD_WIDTH 64
+
+    // zero bytes every source is followed by, so lookahead and wide loads never need a bounds check
+#define LEXER_INPUT_PADDING ( LEXER_SIMD_WIDTH + sizeof( lexer_longest_prefix_t ) )
+
     typedef struct {
         size_t start;
         size_t end;
     } lexer_slice_t;
 
+    typedef struct lexer_arena_chunk_t {
+        struct lexer_arena_chunk_t* prev;
+
+        size_t capacity;
+        size_t used;
+    } lexer_arena_chunk_t;
+
+    // bump allocator for data that lives as long as the lexer, e.g. decoded string literals
+    typedef struct {
+        lexer_arena_chunk_t* head;
+    } lexer_arena_t;
+
+    void* lexer_arena_alloc( lexer_arena_t* arena, size_t size ) {
+        lexer_arena_chunk_t* chunk = arena->head;
+        if ( !chunk || chunk->capacity - chunk->used < size ) {
+            size_t capacity = size > LEXER_ARENA_CHUNK_SIZE ? size : LEXER_ARENA_CHUNK_SIZE;
+            chunk = (lexer_arena_chunk_t*)malloc( sizeof( lexer_arena_chunk_t ) + capacity );
+            if ( !chunk ) {
+                fprintf( stderr, "[FATAL]: could not allocate memory for lexer_arena_t\n" );
+                exit( EXIT_FAILURE );
+            }
+            chunk->prev = arena->head;
+            chunk->capacity = capacity;
+            chunk->used = 0;
+            arena->head = chunk;
+        }
+
+        void* data = (char*)( chunk + 1 ) + chunk->used;
+        chunk->used += size;
+        return data;
+    }
+
+    // gives back the last `size` bytes of the most recent allocation
+    void lexer_arena_trim( lexer_arena_t* arena, size_t size ) {
+        arena->head->used -= size;
+    }
+
+    void lexer_arena_free( lexer_arena_t* arena ) {
+        while ( arena->head ) {
+            lexer_arena_chunk_t* prev = arena->head->prev;
+            free( (void*)arena->head );
+            arena->head = prev;
+        }
+    }
+
+    // utf-8 contents of a string literal or identifier, not nul-terminated. points straight into the
+    // source when there was nothing to unescape, otherwise into the lexer's arena
     typedef struct {
+        const char* str;
         size_t length;
-        size_t capacity;
-        uint32_t* str;
     } string_literal_t;
 
-    string_literal_t* string_literal_create( void ) {
-        string_literal_t* string = (string_literal_t*)calloc( 1, sizeof( string_literal_t ) );
-        if ( !string ) {
-            fprintf( stderr, "[FATAL]: could not allocate memory for `string_literal_t`\n" );
-            exit( EXIT_FAILURE );
+    size_t lexer_encode_utf8( char* out, uint32_t c ) {
+        if ( c < 0x80 ) {
+            out[0] = (char)c;
+            return 1;
         }
-        string->length = 0;
-        string->capacity = 1;
-        string->str = (uint32_t*)calloc( string->capacity, sizeof( uint32_t ) );
-        if ( !string->str ) {
-            fprintf( stderr, "[FATAL]: could not allocate memory for `string_literal_t.str`\n" );
-            exit( EXIT_FAILURE );
+
+        size_t length = c < 0x800 ? 2 : c < 0x10000 ? 3 : c < 0x200000 ? 4 : c < 0x4000000 ? 5 : 6;
+        for ( size_t i = length - 1; i > 0; i-- ) {
+            out[i] = (char)( 0x80 | ( c & 0x3f ) );
+            c >>= 6;
         }
-        return string;
+        out[0] = (char)( ( 0xff00 >> length ) | c );
+        return length;
     }
 
-    void string_literal_free( string_literal_t* string ) {
-        free( (void*)string->str );
-        free( (void*)string );
-    }
+    // decodes `string` into a newly allocated, nul-terminated utf-32 buffer which the caller frees.
+    // bytes that aren't valid utf-8 are passed through as their own codepoint
+    uint32_t* string_literal_to_utf32( const string_literal_t* string, size_t* length ) {
+        uint32_t* out = (uint32_t*)malloc( ( string->length + 1 ) * sizeof( uint32_t ) );
+        if ( !out ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for utf-32 string\n" );
+            exit( EXIT_FAILURE );
+        }
 
-    void string_literal_append( string_literal_t* string, uint32_t c ) {
-        if ( string->length + 1 == string->capacity ) {
-            string->capacity <<= 1;
-            string->str = realloc( string->str, string->capacity * sizeof( uint32_t ) );
-            if ( !string->str ) {
-                fprintf( stderr, "[FATAL]: could not reallocate memory for `string_literal_t.str`\n" );
-                exit( EXIT_FAILURE );
+        const unsigned char* s = (const unsigned char*)string->str;
+        size_t n = 0;
+        for ( size_t i = 0; i < string->length; ) {
+            unsigned char lead = s[i];
+            size_t extra = lead >= 0xfc ? 5 : lead >= 0xf8 ? 4 : lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : 0;
+
+            uint32_t c = lead & ( 0x7f >> extra );
+            size_t j = 1;
+            for ( ; j <= extra && i + j < string->length && ( s[i + j] & 0xc0 ) == 0x80; j++ ) {
+                c = ( c << 6 ) | ( s[i + j] & 0x3f );
+            }
+
+            if ( j <= extra ) {
+                out[n++] = lead;
+                i += 1;
+            } else {
+                out[n++] = c;
+                i += j;
             }
         }
 
-        string->str[string->length] = c;
-        string->length += 1;
-        string->str[string->length] = 0;
+        out[n] = 0;
+        if ( length ) {
+            *length = n;
+        }
+        return out;
+    }
+
+    // fnv-1a, seeded with 0xcbf29ce484222325 for a fresh hash
+    uint64_t lexer_hash_bytes( uint64_t hash, const void* data, size_t size ) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for ( size_t i = 0; i < size; i++ ) {
+            hash = ( hash ^ bytes[i] ) * 0x100000001b3ull;
+        }
+        return hash;
     }
 
     typedef struct {
@@ -159,10 +312,20 @@ extern "C" {
             punctuation_type_t punct;
             keyword_type_t keyword;
             uint64_t i;
-            string_literal_t* string;
+            string_literal_t string;
             double d;
             float f;
         };
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        // index into `lexer_t.constant_pool` for integer, character, string and floating point literals
+        size_t constant;
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+
+    # if LEXER_SUPPORT_TOKEN_HASH
+        // fingerprint of the token's type, subtype and decoded value, see `token_hash`
+        uint64_t hash;
+    # endif // LEXER_SUPPORT_TOKEN_HASH
     } token_t;
 
     void token_print_lexeme( const char* source, const lexer_slice_t* slice ) {
@@ -205,6 +368,102 @@ extern "C" {
         return token;
     }
 
+#if LEXER_SUPPORT_TOKEN_HASH
+    // splitmix64 finaliser, so tokens differing in a single bit still get unrelated fingerprints
+    uint64_t lexer_hash_mix( uint64_t x ) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    // independent of where the token is, so equal tokens in different files or revisions hash equal.
+    // with `LEXER_HASH_ANONYMISE_IDENTIFIERS` every identifier hashes the same, for renaming-tolerant clone search
+    uint64_t token_hash( const token_t* token ) {
+        uint64_t hash = lexer_hash_bytes( 0xcbf29ce484222325ull, &token->type, sizeof( token->type ) );
+
+        switch ( token->type ) {
+        case TOKEN_OPERATOR:
+            hash = lexer_hash_bytes( hash, &token->op, sizeof( token->op ) );
+            break;
+        case TOKEN_PUNCTUATION:
+            hash = lexer_hash_bytes( hash, &token->punct, sizeof( token->punct ) );
+            break;
+        case TOKEN_KEYWORD:
+            hash = lexer_hash_bytes( hash, &token->keyword, sizeof( token->keyword ) );
+            break;
+        case TOKEN_IDENTIFIER:
+        # if !LEXER_HASH_ANONYMISE_IDENTIFIERS
+            hash = lexer_hash_bytes( hash, token->string.str, token->string.length );
+        # endif // !LEXER_HASH_ANONYMISE_IDENTIFIERS
+            break;
+        case TOKEN_STRING:
+            hash = lexer_hash_bytes( hash, token->string.str, token->string.length );
+            break;
+        case TOKEN_FLOAT:
+            hash = lexer_hash_bytes( hash, &token->f, sizeof( token->f ) );
+            break;
+        case TOKEN_DOUBLE:
+            hash = lexer_hash_bytes( hash, &token->d, sizeof( token->d ) );
+            break;
+        default:
+            hash = lexer_hash_bytes( hash, &token->i, sizeof( token->i ) );
+            break;
+        }
+
+        return lexer_hash_mix( hash );
+    }
+
+#define LEXER_ROLLING_HASH_BASE 0x9e3779b97f4a7c15ull
+
+    // polynomial hash over a sliding window of token fingerprints. `power` is the base raised to
+    // `window - 1`, used to drop the oldest token when the window moves
+    typedef struct {
+        uint64_t hash;
+        uint64_t power;
+        size_t window;
+    } lexer_rolling_hash_t;
+
+    // hashes `tokens[0 .. window)`
+    lexer_rolling_hash_t lexer_rolling_hash_init( const token_t* tokens, size_t window ) {
+        lexer_rolling_hash_t rolling;
+        rolling.hash = 0;
+        rolling.power = 1;
+        rolling.window = window;
+
+        for ( size_t i = 0; i < window; i++ ) {
+            rolling.hash = rolling.hash * LEXER_ROLLING_HASH_BASE + tokens[i].hash;
+            if ( i ) {
+                rolling.power *= LEXER_ROLLING_HASH_BASE;
+            }
+        }
+        return rolling;
+    }
+
+    // slides the window one token forward, dropping `out` and taking in `in`
+    void lexer_rolling_hash_roll( lexer_rolling_hash_t* rolling, const token_t* out, const token_t* in ) {
+        rolling->hash = ( rolling->hash - out->hash * rolling->power ) * LEXER_ROLLING_HASH_BASE + in->hash;
+    }
+
+    // writes the hash of every `window`-token run in `tokens` to `hashes`, which needs room for
+    // `count - window + 1` entries. returns how many were written
+    size_t lexer_window_hashes( const token_t* tokens, size_t count, size_t window, uint64_t* hashes ) {
+        if ( window == 0 || count < window ) {
+            return 0;
+        }
+
+        lexer_rolling_hash_t rolling = lexer_rolling_hash_init( tokens, window );
+        hashes[0] = rolling.hash;
+        for ( size_t i = window; i < count; i++ ) {
+            lexer_rolling_hash_roll( &rolling, &tokens[i - window], &tokens[i] );
+            hashes[i - window + 1] = rolling.hash;
+        }
+        return count - window + 1;
+    }
+#endif // LEXER_SUPPORT_TOKEN_HASH
+
     typedef struct {
         token_t* tokens;
 
@@ -226,15 +485,6 @@ extern "C" {
     }
 
     void token_list_deinit( token_list_t* token_list ) {
-        for ( size_t i = 0; i < token_list->length; i++ ) {
-            switch ( token_list->tokens[i].type ) {
-            case TOKEN_STRING:
-            case TOKEN_IDENTIFIER:
-                string_literal_free( (void*)token_list->tokens[i].string );
-            default:
-                break;
-            }
-        }
         free( (void*)token_list->tokens );
         token_list->length = 0;
         token_list->capacity = 0;
@@ -254,9 +504,193 @@ extern "C" {
         token_list->length += 1;
     }
 
+#if LEXER_SUPPORT_CONSTANT_POOL
+    typedef struct {
+        token_type_t type;
+
+        union {
+            uint64_t i;
+            string_literal_t string;
+            double d;
+            float f;
+        };
+    } lexer_constant_t;
+
+    // every distinct literal value seen by the lexer. `slots` is an open addressing table of
+    // constant index + 1, with 0 marking an empty slot
+    typedef struct {
+        lexer_constant_t* constants;
+        size_t capacity;
+        size_t length;
+
+        size_t* slots;
+        size_t slot_count;
+    } lexer_constant_pool_t;
+
+    bool lexer_is_constant( token_type_t type ) {
+        return type == TOKEN_INTEGER || type == TOKEN_CHARACTER || type == TOKEN_STRING || type == TOKEN_FLOAT || type == TOKEN_DOUBLE;
+    }
+
+    // constants are keyed by their bit pattern, so e.g. `0.0` and `-0.0` stay distinct
+    const void* lexer_constant_key( const lexer_constant_t* constant, size_t* size ) {
+        switch ( constant->type ) {
+        case TOKEN_STRING:
+            *size = constant->string.length;
+            return constant->string.str;
+        case TOKEN_FLOAT:
+            *size = sizeof( constant->f );
+            return &constant->f;
+        case TOKEN_DOUBLE:
+            *size = sizeof( constant->d );
+            return &constant->d;
+        default:
+            *size = sizeof( constant->i );
+            return &constant->i;
+        }
+    }
+
+    uint64_t lexer_constant_hash( const lexer_constant_t* constant ) {
+        size_t size;
+        const void* key = lexer_constant_key( constant, &size );
+        uint64_t hash = lexer_hash_bytes( 0xcbf29ce484222325ull, &constant->type, sizeof( constant->type ) );
+        return lexer_hash_bytes( hash, key, size );
+    }
+
+    bool lexer_constant_equal( const lexer_constant_t* a, const lexer_constant_t* b ) {
+        size_t a_size, b_size;
+        const void* a_key = lexer_constant_key( a, &a_size );
+        const void* b_key = lexer_constant_key( b, &b_size );
+        return a->type == b->type && a_size == b_size && memcmp( a_key, b_key, a_size ) == 0;
+    }
+
+    void lexer_constant_pool_insert_slot( lexer_constant_pool_t* pool, size_t index ) {
+        size_t mask = pool->slot_count - 1;
+        size_t slot = (size_t)lexer_constant_hash( &pool->constants[index] ) & mask;
+        while ( pool->slots[slot] ) {
+            slot = ( slot + 1 ) & mask;
+        }
+        pool->slots[slot] = index + 1;
+    }
+
+    void lexer_constant_pool_grow( lexer_constant_pool_t* pool ) {
+        free( (void*)pool->slots );
+        pool->slot_count = pool->slot_count ? pool->slot_count << 1 : 64;
+        pool->slots = (size_t*)calloc( pool->slot_count, sizeof( size_t ) );
+        if ( !pool->slots ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for lexer_constant_pool_t.slots\n" );
+            exit( EXIT_FAILURE );
+        }
+
+        for ( size_t i = 0; i < pool->length; i++ ) {
+            lexer_constant_pool_insert_slot( pool, i );
+        }
+    }
+
+    // returns the index of `constant` in the pool, adding it if it hasn't been seen yet
+    size_t lexer_constant_pool_intern( lexer_constant_pool_t* pool, const lexer_constant_t* constant, bool* added ) {
+        if ( ( pool->length + 1 ) * 2 > pool->slot_count ) {
+            lexer_constant_pool_grow( pool );
+        }
+
+        size_t mask = pool->slot_count - 1;
+        for ( size_t slot = (size_t)lexer_constant_hash( constant ) & mask; pool->slots[slot]; slot = ( slot + 1 ) & mask ) {
+            if ( lexer_constant_equal( &pool->constants[pool->slots[slot] - 1], constant ) ) {
+                *added = false;
+                return pool->slots[slot] - 1;
+            }
+        }
+
+        if ( pool->length == pool->capacity ) {
+            pool->capacity = pool->capacity ? pool->capacity << 1 : 64;
+            pool->constants = (lexer_constant_t*)realloc( pool->constants, sizeof( lexer_constant_t ) * pool->capacity );
+            if ( !pool->constants ) {
+                fprintf( stderr, "[FATAL]: could not reallocate memory for lexer_constant_pool_t\n" );
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        pool->constants[pool->length] = *constant;
+        lexer_constant_pool_insert_slot( pool, pool->length );
+        pool->length += 1;
+
+        *added = true;
+        return pool->length - 1;
+    }
+
+    void lexer_constant_pool_free( lexer_constant_pool_t* pool ) {
+        free( (void*)pool->constants );
+        free( (void*)pool->slots );
+        pool->constants = NULL;
+        pool->slots = NULL;
+        pool->length = 0;
+        pool->capacity = 0;
+        pool->slot_count = 0;
+    }
+#endif // LEXER_SUPPORT_CONSTANT_POOL
+
+#if LEXER_SUPPORT_BRACKET_INDEX
+#define LEXER_NO_MATCH SIZE_MAX
+
+    // parallel to `lexer_t.token_list`. `parent` links each opener to the innermost opener that was still
+    // unclosed when it was lexed, which doubles as the stack of open brackets
+    typedef struct {
+        size_t match;
+        size_t parent;
+    } lexer_bracket_t;
+
+    // the closing bracket paired with `type`, or -1 if `type` doesn't open a pair
+    int lexer_bracket_closer( punctuation_type_t type ) {
+        switch ( type ) {
+        # define LEXER_BRACKET(open, close) case open: return close;
+            LEXER_BRACKET_LIST
+        # undef LEXER_BRACKET
+        default: return -1;
+        }
+    }
+
+    bool lexer_bracket_is_closer( punctuation_type_t type ) {
+        switch ( type ) {
+        # define LEXER_BRACKET(open, close) case close: return true;
+            LEXER_BRACKET_LIST
+        # undef LEXER_BRACKET
+        default: return false;
+        }
+    }
+#endif // LEXER_SUPPORT_BRACKET_INDEX
+
+#if LEXER_SUPPORT_RESYNC
+    // a point the lexer can restart from: a token boundary, or somewhere inside a multiline comment (which
+    // started at `comment_line`:`comment_column`). strings are only ever resumed from their start, since
+    // their token has to cover all of them anyway
+    typedef struct {
+        size_t cursor;
+        size_t line;
+        size_t column;
+
+        bool in_comment;
+        size_t comment_line;
+        size_t comment_column;
+    } lexer_resync_t;
+
+    // what `lexer_parse_range` lexes into, kept apart so the lexer's own tokens, strings and constants
+    // survive any number of range requests
+    typedef struct {
+        token_list_t token_list;
+        lexer_arena_t arena;
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        lexer_constant_pool_t constant_pool;
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+    } lexer_range_t;
+#endif // LEXER_SUPPORT_RESYNC
+
+    // receives every token instead of `lexer_t.token_list` when set
+    typedef void ( *lexer_token_sink_t )( void* userdata, token_t* token );
+
     typedef struct {
         const char* source;
         size_t size;
+        bool borrowed_source;
 
         size_t cursor;
 
@@ -264,9 +698,49 @@ extern "C" {
         size_t column;
 
         token_list_t token_list;
+        lexer_arena_t arena;
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        lexer_constant_pool_t constant_pool;
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        lexer_bracket_t* brackets;
+        size_t bracket_capacity;
+        size_t bracket_open;
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
+
+    # if LEXER_SUPPORT_RESYNC
+        // ascending, at least `LEXER_RESYNC_INTERVAL` bytes apart, covering everything lexed so far
+        lexer_resync_t* resyncs;
+        size_t resync_capacity;
+        size_t resync_length;
+
+        lexer_range_t range;
+        // multiline comments reaching this far end lexing, see `lexer_parse_range`
+        size_t range_end;
+    # endif // LEXER_SUPPORT_RESYNC
+
+        lexer_token_sink_t sink;
+        void* sink_userdata;
+
+        // set while tokens are dropped from `token_list` as lexing goes, e.g. by `LEXER_PARSE_VISIT`,
+        // so brackets aren't indexed
+        bool unindexed;
     } lexer_inner_t, * lexer_t;
 
-    lexer_t lexer_create_from_string( const char* string ) {
+    // allocates room for `size` bytes of source followed by a zeroed `LEXER_INPUT_PADDING` tail
+    char* lexer_alloc_padded( size_t size ) {
+        char* buffer = (char*)malloc( size + LEXER_INPUT_PADDING );
+        if ( !buffer ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for padded lexer input\n" );
+            exit( EXIT_FAILURE );
+        }
+        memset( buffer + size, 0, LEXER_INPUT_PADDING );
+        return buffer;
+    }
+
+    lexer_inner_t* lexer_alloc( void ) {
         lexer_inner_t* lexer = (lexer_inner_t*)calloc( 1, sizeof( lexer_inner_t ) );
         if ( !lexer ) {
             fprintf( stderr, "[FATAL]: could not allocate memory for lexer_t\n" );
@@ -279,29 +753,176 @@ extern "C" {
         lexer->cursor = 0;
 
         lexer->token_list = token_list_init();
+    # if LEXER_SUPPORT_RESYNC
+        lexer->range.token_list = token_list_init();
+        lexer->range_end = SIZE_MAX;
+    # endif // LEXER_SUPPORT_RESYNC
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        lexer->bracket_open = LEXER_NO_MATCH;
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
+        return lexer;
+    }
+
+    lexer_t lexer_create_from_string( const char* string ) {
+        lexer_inner_t* lexer = lexer_alloc();
         lexer->size = strlen( string );
 
-        lexer->source = strdup( string );
-        if ( !lexer->source ) {
-            fprintf( stderr, "[FATAL]: could not allocate memory for lexer_t.source\n" );
-            exit( EXIT_FAILURE );
+        char* source = lexer_alloc_padded( lexer->size );
+        memcpy( source, string, lexer->size );
+        lexer->source = source;
+
+        return lexer;
+    }
+
+    // lexes `buffer` in place. it must stay alive until `lexer_free` and be followed by `LEXER_INPUT_PADDING`
+    // zero bytes, e.g. by coming from `lexer_alloc_padded`
+    lexer_t lexer_create_from_padded( const char* buffer, size_t size ) {
+        for ( size_t i = 0; i < LEXER_INPUT_PADDING; i++ ) {
+            if ( buffer[size + i] ) {
+                fprintf( stderr, "[FATAL]: lexer input is missing its zeroed padding\n" );
+                exit( EXIT_FAILURE );
+            }
         }
 
+        lexer_inner_t* lexer = lexer_alloc();
+        lexer->size = size;
+        lexer->source = buffer;
+        lexer->borrowed_source = true;
+
         return lexer;
     }
 
     void lexer_free( lexer_t lexer ) {
-        free( (void*)lexer->source );
+        if ( !lexer->borrowed_source ) {
+            free( (void*)lexer->source );
+        }
         lexer->cursor = 0;
         lexer->line = 0;
         token_list_deinit( &lexer->token_list );
+        lexer_arena_free( &lexer->arena );
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        lexer_constant_pool_free( &lexer->constant_pool );
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        free( (void*)lexer->brackets );
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
+    # if LEXER_SUPPORT_RESYNC
+        free( (void*)lexer->resyncs );
+        token_list_deinit( &lexer->range.token_list );
+        lexer_arena_free( &lexer->range.arena );
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        lexer_constant_pool_free( &lexer->range.constant_pool );
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+    # endif // LEXER_SUPPORT_RESYNC
         lexer->size = 0;
 
         free( (void*)lexer );
     }
 
+#if LEXER_SUPPORT_CONSTANT_POOL
+    void lexer_intern_constant( lexer_t lexer, token_t* token ) {
+        lexer_constant_t constant;
+        constant.type = token->type;
+        switch ( token->type ) {
+        case TOKEN_STRING: constant.string = token->string; break;
+        case TOKEN_FLOAT:  constant.f = token->f; break;
+        case TOKEN_DOUBLE: constant.d = token->d; break;
+        default:           constant.i = token->i; break;
+        }
+
+        bool added;
+        token->constant = lexer_constant_pool_intern( &lexer->constant_pool, &constant, &added );
+        if ( added || token->type != TOKEN_STRING ) {
+            return;
+        }
+
+        // share the pooled copy, and hand back the arena bytes if this one was just decoded there
+        lexer_arena_chunk_t* chunk = lexer->arena.head;
+        const char* end = token->string.str + token->string.length;
+        if ( chunk && end == (const char*)( chunk + 1 ) + chunk->used && token->string.str >= (const char*)( chunk + 1 ) ) {
+            lexer_arena_trim( &lexer->arena, token->string.length );
+        }
+        token->string = lexer->constant_pool.constants[token->constant].string;
+    }
+#endif // LEXER_SUPPORT_CONSTANT_POOL
+
+#if LEXER_SUPPORT_BRACKET_INDEX
+    void lexer_index_bracket( lexer_t lexer, size_t index ) {
+        if ( lexer->bracket_capacity < lexer->token_list.capacity ) {
+            lexer->bracket_capacity = lexer->token_list.capacity;
+            lexer->brackets = (lexer_bracket_t*)realloc( lexer->brackets, sizeof( lexer_bracket_t ) * lexer->bracket_capacity );
+            if ( !lexer->brackets ) {
+                fprintf( stderr, "[FATAL]: could not reallocate memory for lexer_t.brackets\n" );
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        lexer_bracket_t* bracket = &lexer->brackets[index];
+        bracket->match = LEXER_NO_MATCH;
+        bracket->parent = LEXER_NO_MATCH;
+
+        token_t* token = &lexer->token_list.tokens[index];
+        if ( token->type != TOKEN_PUNCTUATION ) {
+            return;
+        }
+
+        if ( lexer_bracket_closer( token->punct ) >= 0 ) {
+            bracket->parent = lexer->bracket_open;
+            lexer->bracket_open = index;
+        } else if ( lexer_bracket_is_closer( token->punct ) ) {
+            if ( lexer->bracket_open == LEXER_NO_MATCH ) {
+                fprintf( stderr, "[FATAL]: unmatched `%s` at %zu:%zu\n", punctuation_defs[token->punct].symbol, token->line, token->column );
+                exit( EXIT_FAILURE );
+            }
+
+            token_t* opener = &lexer->token_list.tokens[lexer->bracket_open];
+            if ( lexer_bracket_closer( opener->punct ) != (int)token->punct ) {
+                fprintf( stderr, "[FATAL]: mismatched `%s` at %zu:%zu, expected `%s` to close `%s` at %zu:%zu\n",
+                    punctuation_defs[token->punct].symbol, token->line, token->column,
+                    punctuation_defs[lexer_bracket_closer( opener->punct )].symbol, punctuation_defs[opener->punct].symbol, opener->line, opener->column );
+                exit( EXIT_FAILURE );
+            }
+
+            bracket->match = lexer->bracket_open;
+            lexer->brackets[lexer->bracket_open].match = index;
+            lexer->bracket_open = lexer->brackets[lexer->bracket_open].parent;
+        }
+    }
+
+    // index of the token closing (or opening) the bracket token at `index` in `lexer_t.token_list`, or
+    // `LEXER_NO_MATCH` if it isn't a bracket, its partner hasn't been lexed yet or it was never indexed.
+    // lets a parser skip a whole body in one step. tokens from `lexer_parse_range` have no entry
+    size_t lexer_bracket_match( lexer_t lexer, size_t index ) {
+        if ( index >= lexer->token_list.length || index >= lexer->bracket_capacity ) {
+            return LEXER_NO_MATCH;
+        }
+        return lexer->brackets[index].match;
+    }
+#endif // LEXER_SUPPORT_BRACKET_INDEX
+
     void lexer_add_token( lexer_t lexer, token_t* token ) {
+    # if LEXER_SUPPORT_TOKEN_HASH
+        token->hash = token_hash( token );
+    # endif // LEXER_SUPPORT_TOKEN_HASH
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        if ( lexer_is_constant( token->type ) ) {
+            lexer_intern_constant( lexer, token );
+        }
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+
+        if ( lexer->sink ) {
+            lexer->sink( lexer->sink_userdata, token );
+            return;
+        }
         token_list_add( &lexer->token_list, token );
+
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        if ( lexer->unindexed ) {
+            return;
+        }
+        lexer_index_bracket( lexer, lexer->token_list.length - 1 );
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
     }
 
     void lexer_add_operator( lexer_t lexer, operator_type_t type, size_t length ) {
@@ -324,20 +945,14 @@ extern "C" {
         lexer->column += x;
     }
 
+    // no bounds checks: every source is followed by `LEXER_INPUT_PADDING` zero bytes, and every
+    // loop over the source stops at the first '\0'
     char lexer_next( lexer_inner_t* lexer ) {
-        if ( lexer->cursor >= lexer->size ) {
-            return '\0';
-        }
-
         lexer_advance( lexer, 1 );
         return lexer->source[lexer->cursor];
     }
 
     char lexer_peekx( lexer_inner_t* lexer, size_t x ) {
-        if ( lexer->cursor + x >= lexer->size ) {
-            return '\0';
-        }
-
         return lexer->source[lexer->cursor + x];
     }
 
@@ -350,15 +965,7 @@ extern "C" {
     }
 
     bool lexer_parse_operator( lexer_t lexer ) {
-        static size_t max_len = 0;
-        if ( max_len == 0 ) {
-            for ( size_t i = 0; i < sizeof( operator_defs ) / sizeof( operator_defs[0] ); i++ ) {
-                if ( operator_defs[i].length > max_len )
-                    max_len = operator_defs[i].length;
-            }
-        }
-
-        for ( size_t pass = max_len; pass > 0; pass-- ) {
+        for ( size_t pass = LEXER_MAX_OPERATOR_LENGTH; pass > 0; pass-- ) {
             for ( size_t i = 0; i < sizeof( operator_defs ) / sizeof( operator_defs[0] ); i++ ) {
                 operator_def_t* operator = &operator_defs[i];
 
@@ -366,12 +973,10 @@ extern "C" {
                     continue;
                 }
 
-                if ( lexer->cursor + operator->length <= lexer->size ) {
-                    if ( strncmp( lexer->source + lexer->cursor, operator->symbol, operator->length ) == 0 ) {
-                        lexer_add_operator( lexer, operator->type, operator->length );
-                        for ( size_t j = 0; j < operator->length - 1; j++ ) lexer_next( lexer );
-                        return true;
-                    }
+                if ( memcmp( lexer->source + lexer->cursor, operator->symbol, operator->length ) == 0 ) {
+                    lexer_add_operator( lexer, operator->type, operator->length );
+                    for ( size_t j = 0; j < operator->length - 1; j++ ) lexer_next( lexer );
+                    return true;
                 }
             }
         }
@@ -380,15 +985,7 @@ extern "C" {
     }
 
     bool lexer_parse_punctuation( lexer_t lexer ) {
-        static size_t max_len = 0;
-        if ( max_len == 0 ) {
-            for ( size_t i = 0; i < sizeof( punctuation_defs ) / sizeof( punctuation_defs[0] ); i++ ) {
-                if ( punctuation_defs[i].length > max_len )
-                    max_len = punctuation_defs[i].length;
-            }
-        }
-
-        for ( size_t pass = max_len; pass > 0; pass-- ) {
+        for ( size_t pass = LEXER_MAX_PUNCTUATION_LENGTH; pass > 0; pass-- ) {
             for ( size_t i = 0; i < sizeof( punctuation_defs ) / sizeof( punctuation_defs[0] ); i++ ) {
                 punctuation_def_t* punctuation = &punctuation_defs[i];
 
@@ -396,12 +993,10 @@ extern "C" {
                     continue;
                 }
 
-                if ( lexer->cursor + punctuation->length <= lexer->size ) {
-                    if ( strncmp( lexer->source + lexer->cursor, punctuation->symbol, punctuation->length ) == 0 ) {
-                        lexer_add_punct( lexer, punctuation->type, punctuation->length );
-                        for ( size_t j = 0; j < punctuation->length - 1; j++ ) lexer_next( lexer );
-                        return true;
-                    }
+                if ( memcmp( lexer->source + lexer->cursor, punctuation->symbol, punctuation->length ) == 0 ) {
+                    lexer_add_punct( lexer, punctuation->type, punctuation->length );
+                    for ( size_t j = 0; j < punctuation->length - 1; j++ ) lexer_next( lexer );
+                    return true;
                 }
             }
         }
@@ -410,15 +1005,7 @@ extern "C" {
     }
 
     bool lexer_parse_keyword( lexer_t lexer ) {
-        static size_t max_len = 0;
-        if ( max_len == 0 ) {
-            for ( size_t i = 0; i < sizeof( keyword_defs ) / sizeof( keyword_defs[0] ); i++ ) {
-                if ( keyword_defs[i].length > max_len )
-                    max_len = keyword_defs[i].length;
-            }
-        }
-
-        for ( size_t pass = max_len; pass > 0; pass-- ) {
+        for ( size_t pass = LEXER_MAX_KEYWORD_LENGTH; pass > 0; pass-- ) {
             for ( size_t i = 0; i < sizeof( keyword_defs ) / sizeof( keyword_defs[0] ); i++ ) {
                 keyword_def_t* keyword = &keyword_defs[i];
 
@@ -426,12 +1013,10 @@ extern "C" {
                     continue;
                 }
 
-                if ( lexer->cursor + keyword->length <= lexer->size ) {
-                    if ( strncmp( lexer->source + lexer->cursor, keyword->symbol, keyword->length ) == 0 ) {
-                        lexer_add_keyword( lexer, keyword->type, keyword->length );
-                        for ( size_t j = 0; j < keyword->length - 1; j++ ) lexer_next( lexer );
-                        return true;
-                    }
+                if ( memcmp( lexer->source + lexer->cursor, keyword->symbol, keyword->length ) == 0 ) {
+                    lexer_add_keyword( lexer, keyword->type, keyword->length );
+                    for ( size_t j = 0; j < keyword->length - 1; j++ ) lexer_next( lexer );
+                    return true;
                 }
             }
         }
@@ -625,7 +1210,7 @@ extern "C" {
     }
 
     uint16_t lexer_handle_unicode_escape16( lexer_t lexer, bool is_fallback ) {
-        char buffer[4] = { 0 };
+        char buffer[5] = { 0 };
         for ( int i = 0; i < 4; i++ ) {
             char c = lexer_peek( lexer );
             if ( !isxdigit( c ) ) {
@@ -641,7 +1226,7 @@ extern "C" {
     }
 
     uint32_t lexer_handle_unicode_escape32( lexer_t lexer, bool is_fallback ) {
-        char buffer[8] = { 0 };
+        char buffer[9] = { 0 };
         for ( int i = 0; i < 8; i++ ) {
             char c = lexer_peek( lexer );
             if ( !isxdigit( c ) ) {
@@ -724,19 +1309,35 @@ extern "C" {
             return false;
         }
 
-        string_literal_t* string = string_literal_create();
-
         lexer_advance( lexer, delimiter_size );
 
-        for ( uint64_t c = lexer_current( lexer ); strncmp( lexer->source + lexer->cursor, str, delimiter_size ); c = lexer_next( lexer ) ) {
+        // most literals have nothing to decode at all. otherwise every escape starts at an escape character,
+        // takes at least that byte and decodes to at most 6, which bounds the decoded size whatever
+        // `LEXER_ESCAPE_CHAR_LIST` maps escapes to
+        const char* contents = lexer->source + lexer->cursor;
+        const char* p = contents;
+        size_t escapes = 0;
+        for ( ; *p && memcmp( p, str, delimiter_size ); p++ ) {
+            if ( *p == LEXER_ESCAPE_CHAR && p[1] ) {
+                escapes += 1 + ( p[1] == LEXER_ESCAPE_CHAR );
+                p++;
+            }
+        }
+
+        size_t raw_length = (size_t)( p - contents );
+        size_t capacity = raw_length + escapes * 5;
+        char* decoded = escapes ? (char*)lexer_arena_alloc( &lexer->arena, capacity ) : NULL;
+        size_t length = 0;
+
+        for ( uint64_t c = (unsigned char)lexer_current( lexer ); memcmp( lexer->source + lexer->cursor, str, delimiter_size ); c = (unsigned char)lexer_next( lexer ) ) {
             if ( c == '\0' ) {
-                fprintf( stderr, "[FATAL]: unterminated string starting at %zu:%zu (expected `%.*s`)\n", line, column, delimiter_size, str );
+                fprintf( stderr, "[FATAL]: unterminated string starting at %zu:%zu (expected `%.*s`)\n", line, column, (int)delimiter_size, str );
                 exit( EXIT_FAILURE );
             }
 
             else if ( c == '\n' ) {
             # if    !LEXER_SUPPORT_MULTILINE_STRINGS
-                fprintf( stderr, "[FATAL]: unterminated string starting at %zu:%zu (expected `%.*s`)\n", line, column, delimiter_size, str );
+                fprintf( stderr, "[FATAL]: unterminated string starting at %zu:%zu (expected `%.*s`)\n", line, column, (int)delimiter_size, str );
                 exit( EXIT_FAILURE );
             # else  // LEXER_SUPPORT_MULTILINE_STRINGS
                 lexer->line += 1;
@@ -746,19 +1347,31 @@ extern "C" {
 
             else if ( c == LEXER_ESCAPE_CHAR ) {
                 c = lexer_unescape_character( lexer );
-                if ( c > UINT32_MAX ) {
+                if ( c > 0x7fffffff ) {
                     fprintf( stderr, "[FATAL]: codepoint `%" PRIu64 "` at %zu:%zu in string literal starting at %zu:%zu exceeds maximum allowed size for string literals\n", c, lexer->line, lexer->column, line, column );
                     exit( EXIT_FAILURE );
                 }
+                length += lexer_encode_utf8( decoded + length, (uint32_t)c );
+                continue;
             }
 
-            string_literal_append( string, c );
+            if ( decoded ) {
+                decoded[length++] = (char)c;
+            }
+        }
 
+        token_t token = token_create_generic( line, column, start, lexer->cursor + delimiter_size );
+        token.type = TOKEN_STRING;
+        if ( decoded ) {
+            lexer_arena_trim( &lexer->arena, capacity - length );
+            token.string.str = decoded;
+            token.string.length = length;
+        } else {
+            token.string.str = contents;
+            token.string.length = raw_length;
         }
+
         lexer_advance( lexer, delimiter_size - 1 );
-        token_t token = token_create_generic( line, column, start, lexer->cursor + 1 );
-        token.type = TOKEN_STRING;
-        token.string = string;
         lexer_add_token( lexer, &token );
         return true;
     }
@@ -767,58 +1380,106 @@ extern "C" {
         size_t start = lexer->cursor;
         size_t column = lexer->column;
 
-        string_literal_t* string = string_literal_create();
-
         char c = lexer_current( lexer );
         if ( !isalpha( c ) && c != '_' ) {
             return false;
         }
-        string_literal_append( string, lexer_current( lexer ) );
 
         while ( 1 ) {
             char la = lexer_peek( lexer );
             if ( !isalnum( la ) && la != '_' ) {
                 break;
             }
-            string_literal_append( string, lexer_next( lexer ) );
+            lexer_next( lexer );
         }
 
         token_t t = token_create_generic( lexer->line, column, start, lexer->cursor + 1 );
 
         t.type = TOKEN_IDENTIFIER;
-        t.string = string;
+        t.string.str = lexer->source + start;
+        t.string.length = lexer->cursor + 1 - start;
 
         lexer_add_token( lexer, &t );
         return true;
     }
 
+#if LEXER_SUPPORT_RESYNC
+    // `comment_line` is 0 outside of a multiline comment
+    void lexer_record_resync( lexer_t lexer, size_t comment_line, size_t comment_column ) {
+        // nothing is left to resume at the end of the source (or past it, once a range has stopped early)
+        size_t last = lexer->resync_length ? lexer->resyncs[lexer->resync_length - 1].cursor : 0;
+        if ( lexer->cursor < last + LEXER_RESYNC_INTERVAL || lexer->cursor >= lexer->size ) {
+            return;
+        }
+
+        if ( lexer->resync_length == lexer->resync_capacity ) {
+            lexer->resync_capacity = lexer->resync_capacity ? lexer->resync_capacity * 2 : 16;
+            lexer->resyncs = (lexer_resync_t*)realloc( lexer->resyncs, sizeof( lexer_resync_t ) * lexer->resync_capacity );
+            if ( !lexer->resyncs ) {
+                fprintf( stderr, "[FATAL]: could not reallocate memory for lexer_t.resyncs\n" );
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        lexer_resync_t* resync = &lexer->resyncs[lexer->resync_length++];
+        resync->cursor = lexer->cursor;
+        resync->line = lexer->line;
+        resync->column = lexer->column;
+        resync->in_comment = comment_line != 0;
+        resync->comment_line = comment_line;
+        resync->comment_column = comment_column;
+    }
+#endif // LEXER_SUPPORT_RESYNC
+
+    // skips to the last character of the comment that opened at `line`:`column`. returns false if it stopped
+    // at `lexer_t.range_end` instead, leaving the cursor at the end of the source
+    bool lexer_skip_multiline_comment( lexer_t lexer, size_t line, size_t column ) {
+        for ( char c = lexer_current( lexer ); c != '\0'; c = lexer_next( lexer ) ) {
+        # if LEXER_SUPPORT_RESYNC
+            // the scan keeps no state besides the cursor, so it can resume from anywhere
+            lexer_record_resync( lexer, line, column );
+            if ( lexer->cursor >= lexer->range_end ) {
+                // no token can start before the comment closes, so skip straight to the end of the source
+                lexer->cursor = lexer->size;
+                return false;
+            }
+        # endif // LEXER_SUPPORT_RESYNC
+
+            if ( c == '\n' ) {
+                lexer->column = 0;
+                lexer->line += 1;
+                continue;
+            } else if ( c == '\r' ) {
+                lexer->column = 0;
+                continue;
+            } else if ( !memcmp( &lexer->source[lexer->cursor], LEXER_MULTILINE_COMMENT_CLOSE, strlen( LEXER_MULTILINE_COMMENT_CLOSE ) ) ) {
+                lexer_advance( lexer, strlen( LEXER_MULTILINE_COMMENT_CLOSE ) - 1 );
+                return true;
+            }
+        }
+
+        fprintf( stderr, "[FATAL]: unclosed multiline comment starting at %zu:%zu\n", line, column );
+        exit( EXIT_FAILURE );
+    }
+
     bool lexer_parse_multiline_comment( lexer_t lexer ) {
         size_t column = lexer->column;
         size_t line = lexer->line;
-        if ( !strncmp( &lexer->source[lexer->cursor], LEXER_MULTILINE_COMMENT_OPEN, strlen( LEXER_MULTILINE_COMMENT_OPEN ) ) ) {
+        if ( !memcmp( &lexer->source[lexer->cursor], LEXER_MULTILINE_COMMENT_OPEN, strlen( LEXER_MULTILINE_COMMENT_OPEN ) ) ) {
             lexer_advance( lexer, strlen( LEXER_MULTILINE_COMMENT_OPEN ) );
-
-            for ( char c = lexer_current( lexer ); c != '\0'; c = lexer_next( lexer ) ) {
-                if ( c == '\n' ) {
-                    lexer->column = 0;
-                    lexer->line += 1;
-                    continue;
-                } else if ( c == '\r' ) {
-                    lexer->column = 0;
-                    continue;
-                } else if ( !strncmp( &lexer->source[lexer->cursor], LEXER_MULTILINE_COMMENT_CLOSE, strlen( LEXER_MULTILINE_COMMENT_CLOSE ) ) ) {
-                    lexer_advance( lexer, strlen( LEXER_MULTILINE_COMMENT_CLOSE ) - 1 );
-                    return true;
-                }
-            }
-
-            fprintf( stderr, "[FATAL]: unclosed multiline comment starting at %zu:%zu\n", line, column );
-            exit( EXIT_FAILURE );
+            lexer_skip_multiline_comment( lexer, line, column );
+            return true;
         }
         return false;
     }
 
-    void lexer_parse( lexer_t lexer ) {
+    // lexes the next token, skipping any whitespace and comments before it. returns false once the
+    // end of the source has been reached
+    bool lexer_parse_next( lexer_t lexer ) {
+    # if LEXER_SUPPORT_RESYNC
+        lexer_record_resync( lexer, 0, 0 );
+    # endif // LEXER_SUPPORT_RESYNC
+
         for ( char c = lexer_current( lexer ); c != '\0'; c = lexer_next( lexer ) ) {
             if ( c == '\n' ) {
                 lexer->column = 0;
@@ -831,18 +1492,19 @@ extern "C" {
             } else if ( c == '\r' ) {
                 lexer->column = 0;
                 continue;
-            } else if ( !strncmp( &lexer->source[lexer->cursor], LEXER_LINE_COMMENT_STRING, strlen( LEXER_LINE_COMMENT_STRING ) ) ) {
+            } else if ( !memcmp( &lexer->source[lexer->cursor], LEXER_LINE_COMMENT_STRING, strlen( LEXER_LINE_COMMENT_STRING ) ) ) {
                 for ( c = lexer_peek( lexer ); c != '\n' && c != '\0'; c = lexer_peek( lexer ) ) {
                     lexer_next( lexer );
                 }
                 continue;
+            } else if ( lexer_parse_multiline_comment( lexer ) ) {
+                continue;
             }
 
             // TODO(hamid): preprocessor
 
             // TODO(hamid): look into a trie data structure for these in the future
-            bool matched = lexer_parse_multiline_comment( lexer )
-                || lexer_parse_string( lexer )
+            bool matched = lexer_parse_string( lexer )
                 || lexer_parse_character( lexer )
                 || lexer_parse_number( lexer )
                 || lexer_parse_operator( lexer )
@@ -854,13 +1516,1127 @@ extern "C" {
                 fprintf( stderr, "[FATAL]: unhandled token at %zu:%zu -> `%c`\n", lexer->line, lexer->column, c );
                 exit( EXIT_FAILURE );
             }
-        }
-    }
 
+            lexer_next( lexer );
+            return true;
+        }
+
+        return false;
+    }
+
+    void lexer_parse( lexer_t lexer ) {
+        while ( lexer_parse_next( lexer ) ) {}
+
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        if ( lexer->bracket_open != LEXER_NO_MATCH && !lexer->sink ) {
+            token_t* opener = &lexer->token_list.tokens[lexer->bracket_open];
+            fprintf( stderr, "[FATAL]: unclosed `%s` at %zu:%zu\n", punctuation_defs[opener->punct].symbol, opener->line, opener->column );
+            exit( EXIT_FAILURE );
+        }
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
+    }
+
+    typedef struct {
+        size_t cursor;
+        size_t line;
+        size_t column;
+
+        size_t token_count;
+
+        lexer_arena_chunk_t* arena_chunk;
+        size_t arena_used;
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        size_t constant_count;
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        size_t bracket_open;
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
+    } lexer_checkpoint_t;
+
+    lexer_checkpoint_t lexer_checkpoint( lexer_t lexer ) {
+        lexer_checkpoint_t checkpoint;
+        checkpoint.cursor = lexer->cursor;
+        checkpoint.line = lexer->line;
+        checkpoint.column = lexer->column;
+
+        checkpoint.token_count = lexer->token_list.length;
+
+        checkpoint.arena_chunk = lexer->arena.head;
+        checkpoint.arena_used = lexer->arena.head ? lexer->arena.head->used : 0;
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        checkpoint.constant_count = lexer->constant_pool.length;
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        checkpoint.bracket_open = lexer->bracket_open;
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
+        return checkpoint;
+    }
+
+    // discards every token, string and constant produced since `checkpoint` and resumes lexing from there.
+    // tokens and arena space are released in constant time (barring whole arena chunks), pooled constants in
+    // time proportional to how many were added. checkpoints taken after `checkpoint` become invalid
+    void lexer_rewind( lexer_t lexer, const lexer_checkpoint_t* checkpoint ) {
+        lexer->cursor = checkpoint->cursor;
+        lexer->line = checkpoint->line;
+        lexer->column = checkpoint->column;
+
+        lexer->token_list.length = checkpoint->token_count;
+
+    # if LEXER_SUPPORT_BRACKET_INDEX
+        // only brackets that were open at the checkpoint can have been closed since
+        lexer->bracket_open = checkpoint->bracket_open;
+        for ( size_t i = lexer->bracket_open; i != LEXER_NO_MATCH; i = lexer->brackets[i].parent ) {
+            lexer->brackets[i].match = LEXER_NO_MATCH;
+        }
+    # endif // LEXER_SUPPORT_BRACKET_INDEX
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        // undoing insertions newest first leaves every remaining probe sequence intact
+        lexer_constant_pool_t* pool = &lexer->constant_pool;
+        while ( pool->length > checkpoint->constant_count ) {
+            pool->length -= 1;
+
+            size_t mask = pool->slot_count - 1;
+            size_t slot = (size_t)lexer_constant_hash( &pool->constants[pool->length] ) & mask;
+            while ( pool->slots[slot] != pool->length + 1 ) {
+                slot = ( slot + 1 ) & mask;
+            }
+            pool->slots[slot] = 0;
+        }
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+
+        while ( lexer->arena.head != checkpoint->arena_chunk ) {
+            lexer_arena_chunk_t* prev = lexer->arena.head->prev;
+            free( (void*)lexer->arena.head );
+            lexer->arena.head = prev;
+        }
+        if ( lexer->arena.head ) {
+            lexer->arena.head->used = checkpoint->arena_used;
+        }
+    }
+
+#if LEXER_SUPPORT_RESYNC
+    void lexer_swap_range( lexer_t lexer ) {
+        lexer_range_t range = lexer->range;
+
+        lexer->range.token_list = lexer->token_list;
+        lexer->range.arena = lexer->arena;
+        lexer->token_list = range.token_list;
+        lexer->arena = range.arena;
+
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        lexer->range.constant_pool = lexer->constant_pool;
+        lexer->constant_pool = range.constant_pool;
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+    }
+
+    // lexes just the tokens overlapping bytes `[start, end)`, resuming from the nearest resync point before
+    // `start` rather than the top of the file. resync points are recorded by every lexing call, so once a region
+    // has been lexed, ranges in it cost time proportional to their length (plus the whole of any string they
+    // start in). the tokens, with their strings and constants, are valid until the next call and never touch
+    // the lexer's own, so a full parse survives alongside. brackets aren't indexed for them
+    const token_list_t* lexer_parse_range( lexer_t lexer, size_t start, size_t end ) {
+        // last resync point at or before `start`
+        size_t low = 0;
+        size_t high = lexer->resync_length;
+        while ( low < high ) {
+            size_t mid = low + ( high - low ) / 2;
+            if ( lexer->resyncs[mid].cursor <= start ) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        size_t cursor = lexer->cursor;
+        size_t line = lexer->line;
+        size_t column = lexer->column;
+        lexer_token_sink_t sink = lexer->sink;
+        bool unindexed = lexer->unindexed;
+
+        lexer_swap_range( lexer );
+        lexer->token_list.length = 0;
+        lexer_arena_free( &lexer->arena );
+    # if LEXER_SUPPORT_CONSTANT_POOL
+        lexer_constant_pool_free( &lexer->constant_pool );
+    # endif // LEXER_SUPPORT_CONSTANT_POOL
+        lexer->sink = NULL;
+        lexer->unindexed = true;
+        lexer->range_end = end;
+
+        lexer->cursor = 0;
+        lexer->line = 1;
+        lexer->column = 1;
+        bool lexing = true;
+        if ( low ) {
+            const lexer_resync_t* resync = &lexer->resyncs[low - 1];
+            lexer->cursor = resync->cursor;
+            lexer->line = resync->line;
+            lexer->column = resync->column;
+            if ( resync->in_comment ) {
+                // the whole range may lie inside the comment
+                lexing = lexer_skip_multiline_comment( lexer, resync->comment_line, resync->comment_column );
+                if ( lexing ) {
+                    lexer_next( lexer );
+                }
+            }
+        }
+
+        token_list_t* list = &lexer->token_list;
+        while ( lexing && lexer_parse_next( lexer ) ) {
+            const lexer_slice_t* lexeme = &list->tokens[list->length - 1].lexeme;
+            if ( lexeme->start >= end ) {
+                list->length -= 1;
+                break;
+            }
+            if ( lexeme->end <= start ) {
+                list->length -= 1;
+            }
+        }
+
+        lexer_swap_range( lexer );
+        lexer->cursor = cursor;
+        lexer->line = line;
+        lexer->column = column;
+        lexer->sink = sink;
+        lexer->unindexed = unindexed;
+        lexer->range_end = SIZE_MAX;
+
+        return &lexer->range.token_list;
+    }
+#endif // LEXER_SUPPORT_RESYNC
+
+    typedef enum {
+        LEXER_STRUCTURAL_OPEN,
+        LEXER_STRUCTURAL_CLOSE,
+        LEXER_STRUCTURAL_TERMINATOR,
+        LEXER_STRUCTURAL_STRING,
+        LEXER_STRUCTURAL_CHARACTER,
+        LEXER_STRUCTURAL_COMMENT,
+    } lexer_structural_kind_t;
+
+    typedef struct {
+        lexer_structural_kind_t kind;
+        punctuation_type_t punct;
+
+        lexer_slice_t extent;
+        size_t line;
+        size_t depth;
+    } lexer_structural_t;
+
+    typedef struct {
+        lexer_structural_t* entries;
+
+        size_t capacity;
+        size_t length;
+    } lexer_structural_index_t;
+
+    enum {
+        LEXER_CLASS_OPEN = 1 << 0,
+        LEXER_CLASS_CLOSE = 1 << 1,
+        LEXER_CLASS_TERMINATOR = 1 << 2,
+        LEXER_CLASS_QUOTE = 1 << 3,
+        LEXER_CLASS_CHAR_QUOTE = 1 << 4,
+        LEXER_CLASS_ESCAPE = 1 << 5,
+        LEXER_CLASS_NEWLINE = 1 << 6,
+        LEXER_CLASS_COMMENT = 1 << 7,
+    };
+
+    // per-byte classes for the structural pre-pass, derived from `lexer.def` on first use
+    typedef struct {
+        uint8_t classes[256];
+        uint8_t punct[256];
+
+        unsigned char chars[256];
+        size_t char_count;
+    } lexer_structural_tables_t;
+
+    static lexer_structural_tables_t lexer_structural_tables;
+
+    enum {
+        LEXER_STRUCTURAL_UNBUILT,
+        LEXER_STRUCTURAL_BUILDING,
+        LEXER_STRUCTURAL_READY,
+    };
+
+    static int lexer_structural_state = LEXER_STRUCTURAL_UNBUILT;
+
+    void lexer_structural_classify( unsigned char c, uint8_t cls ) {
+        lexer_structural_tables_t* tables = &lexer_structural_tables;
+        if ( !tables->classes[c] ) {
+            tables->chars[tables->char_count++] = c;
+        }
+        tables->classes[c] |= cls;
+    }
+
+    void lexer_structural_classify_punct( punctuation_type_t type, uint8_t cls ) {
+        unsigned char c = (unsigned char)punctuation_defs[type].symbol[0];
+        lexer_structural_classify( c, cls );
+        lexer_structural_tables.punct[c] = (uint8_t)( type + 1 );
+    }
+
+    // safe to race from several threads: one builds the tables, the rest wait the few microseconds it takes
+    void lexer_structural_init( void ) {
+        if ( __atomic_load_n( &lexer_structural_state, __ATOMIC_ACQUIRE ) == LEXER_STRUCTURAL_READY ) {
+            return;
+        }
+
+        int expected = LEXER_STRUCTURAL_UNBUILT;
+        if ( !__atomic_compare_exchange_n( &lexer_structural_state, &expected, LEXER_STRUCTURAL_BUILDING, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ) ) {
+            while ( __atomic_load_n( &lexer_structural_state, __ATOMIC_ACQUIRE ) != LEXER_STRUCTURAL_READY ) {}
+            return;
+        }
+
+    # define LEXER_BRACKET(open, close) \
+        lexer_structural_classify_punct( open, LEXER_CLASS_OPEN ); \
+        lexer_structural_classify_punct( close, LEXER_CLASS_CLOSE );
+        LEXER_BRACKET_LIST
+    # undef LEXER_BRACKET
+        lexer_structural_classify_punct( LEXER_STATEMENT_TERMINATOR, LEXER_CLASS_TERMINATOR );
+
+        const char* p = LEXER_STRING_DELIMITERS;
+        while ( *p ) {
+            while ( *p == ' ' ) { p++; }
+            if ( *p ) {
+                lexer_structural_classify( (unsigned char)*p, LEXER_CLASS_QUOTE );
+            }
+            while ( *p && *p != ' ' ) { p++; }
+        }
+
+        lexer_structural_classify( LEXER_CHAR_DELIMITER, LEXER_CLASS_CHAR_QUOTE );
+        lexer_structural_classify( LEXER_ESCAPE_CHAR, LEXER_CLASS_ESCAPE );
+        lexer_structural_classify( '\n', LEXER_CLASS_NEWLINE );
+        lexer_structural_classify( LEXER_LINE_COMMENT_STRING[0], LEXER_CLASS_COMMENT );
+        lexer_structural_classify( LEXER_MULTILINE_COMMENT_OPEN[0], LEXER_CLASS_COMMENT );
+        lexer_structural_classify( LEXER_MULTILINE_COMMENT_CLOSE[0], LEXER_CLASS_COMMENT );
+
+        __atomic_store_n( &lexer_structural_state, LEXER_STRUCTURAL_READY, __ATOMIC_RELEASE );
+    }
+
+    // bit i is set when block[i] has any structural class
+    uint64_t lexer_structural_block_mask( const char* block ) {
+        const lexer_structural_tables_t* tables = &lexer_structural_tables;
+        uint64_t mask = 0;
+    # if defined( __AVX2__ )
+        __m256i lo = _mm256_loadu_si256( (const __m256i*)block );
+        __m256i hi = _mm256_loadu_si256( (const __m256i*)( block + 32 ) );
+        for ( size_t i = 0; i < tables->char_count; i++ ) {
+            __m256i c = _mm256_set1_epi8( (char)tables->chars[i] );
+            uint64_t l = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( lo, c ) );
+            uint64_t h = (uint32_t)_mm256_movemask_epi8( _mm256_cmpeq_epi8( hi, c ) );
+            mask |= l | ( h << 32 );
+        }
+    # elif defined( __SSE2__ )
+        __m128i v0 = _mm_loadu_si128( (const __m128i*)block );
+        __m128i v1 = _mm_loadu_si128( (const __m128i*)( block + 16 ) );
+        __m128i v2 = _mm_loadu_si128( (const __m128i*)( block + 32 ) );
+        __m128i v3 = _mm_loadu_si128( (const __m128i*)( block + 48 ) );
+        for ( size_t i = 0; i < tables->char_count; i++ ) {
+            __m128i c = _mm_set1_epi8( (char)tables->chars[i] );
+            uint64_t m0 = (uint16_t)_mm_movemask_epi8( _mm_cmpeq_epi8( v0, c ) );
+            uint64_t m1 = (uint16_t)_mm_movemask_epi8( _mm_cmpeq_epi8( v1, c ) );
+            uint64_t m2 = (uint16_t)_mm_movemask_epi8( _mm_cmpeq_epi8( v2, c ) );
+            uint64_t m3 = (uint16_t)_mm_movemask_epi8( _mm_cmpeq_epi8( v3, c ) );
+            mask |= m0 | ( m1 << 16 ) | ( m2 << 32 ) | ( m3 << 48 );
+        }
+    # else
+        for ( size_t i = 0; i < 64; i++ ) {
+            if ( tables->classes[(unsigned char)block[i]] ) {
+                mask |= (uint64_t)1 << i;
+            }
+        }
+    # endif
+        return mask;
+    }
+
+    void lexer_structural_index_add( lexer_structural_index_t* index, lexer_structural_kind_t kind, size_t start, size_t end, size_t line, size_t depth, punctuation_type_t punct ) {
+        if ( index->length == index->capacity ) {
+            index->capacity <<= 1;
+            index->entries = (lexer_structural_t*)realloc( index->entries, sizeof( lexer_structural_t ) * index->capacity );
+            if ( !index->entries ) {
+                fprintf( stderr, "[FATAL]: could not reallocate memory for lexer_structural_index_t\n" );
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        lexer_structural_t* entry = &index->entries[index->length];
+        entry->kind = kind;
+        entry->punct = punct;
+        entry->extent.start = start;
+        entry->extent.end = end;
+        entry->line = line;
+        entry->depth = depth;
+        index->length += 1;
+    }
+
+    void lexer_structural_index_free( lexer_structural_index_t* index ) {
+        free( (void*)index->entries );
+        index->entries = NULL;
+        index->length = 0;
+        index->capacity = 0;
+    }
+
+    // skim-only pass over the source: records bracket and statement terminator positions along with
+    // string, character and comment extents without creating any tokens. the lexer itself is untouched
+    lexer_structural_index_t lexer_index_structure( lexer_t lexer ) {
+        enum { IN_CODE, IN_STRING, IN_CHARACTER, IN_LINE_COMMENT, IN_MULTILINE_COMMENT } state = IN_CODE;
+
+        lexer_structural_init();
+        const lexer_structural_tables_t* tables = &lexer_structural_tables;
+
+        lexer_structural_index_t index;
+        index.length = 0;
+        index.capacity = 64;
+        index.entries = (lexer_structural_t*)malloc( sizeof( lexer_structural_t ) * index.capacity );
+        if ( !index.entries ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for lexer_structural_index_t\n" );
+            exit( EXIT_FAILURE );
+        }
+
+        const char* source = lexer->source;
+        size_t size = lexer->size;
+
+        size_t line = 1;
+        size_t depth = 0;
+        size_t skip = 0;
+
+        size_t start = 0;
+        size_t start_line = 0;
+        const char* delimiter = NULL;
+        size_t delimiter_size = 0;
+
+        for ( size_t base = 0; base < size; base += LEXER_SIMD_WIDTH ) {
+            uint64_t mask = lexer_structural_block_mask( source + base );
+
+            for ( ; mask; mask &= mask - 1 ) {
+                size_t i = base + (size_t)__builtin_ctzll( mask );
+                if ( i >= size ) {
+                    break;
+                }
+
+                unsigned char c = (unsigned char)source[i];
+                uint8_t cls = tables->classes[c];
+
+                if ( i < skip ) {
+                    line += ( cls & LEXER_CLASS_NEWLINE ) != 0;
+                    continue;
+                }
+
+                switch ( state ) {
+                case IN_CODE:
+                    if ( cls & LEXER_CLASS_NEWLINE ) {
+                        line += 1;
+                    } else if ( ( cls & LEXER_CLASS_COMMENT ) && !memcmp( source + i, LEXER_LINE_COMMENT_STRING, strlen( LEXER_LINE_COMMENT_STRING ) ) ) {
+                        state = IN_LINE_COMMENT;
+                        start = i;
+                        start_line = line;
+                        skip = i + strlen( LEXER_LINE_COMMENT_STRING );
+                    } else if ( ( cls & LEXER_CLASS_COMMENT ) && !memcmp( source + i, LEXER_MULTILINE_COMMENT_OPEN, strlen( LEXER_MULTILINE_COMMENT_OPEN ) ) ) {
+                        state = IN_MULTILINE_COMMENT;
+                        start = i;
+                        start_line = line;
+                        skip = i + strlen( LEXER_MULTILINE_COMMENT_OPEN );
+                    } else if ( ( cls & LEXER_CLASS_QUOTE ) && ( delimiter_size = match_any( source + i, LEXER_STRING_DELIMITERS ) ) ) {
+                        state = IN_STRING;
+                        start = i;
+                        start_line = line;
+                        delimiter = source + i;
+                        skip = i + delimiter_size;
+                    } else if ( cls & LEXER_CLASS_CHAR_QUOTE ) {
+                        state = IN_CHARACTER;
+                        start = i;
+                        start_line = line;
+                    } else if ( cls & ( LEXER_CLASS_OPEN | LEXER_CLASS_CLOSE | LEXER_CLASS_TERMINATOR ) ) {
+                        punctuation_type_t punct = (punctuation_type_t)( tables->punct[c] - 1 );
+                        size_t length = punctuation_defs[punct].length;
+                        if ( memcmp( source + i, punctuation_defs[punct].symbol, length ) ) {
+                            break;
+                        }
+
+                        if ( cls & LEXER_CLASS_OPEN ) {
+                            lexer_structural_index_add( &index, LEXER_STRUCTURAL_OPEN, i, i + length, line, depth, punct );
+                            depth += 1;
+                        } else if ( cls & LEXER_CLASS_CLOSE ) {
+                            depth -= depth > 0;
+                            lexer_structural_index_add( &index, LEXER_STRUCTURAL_CLOSE, i, i + length, line, depth, punct );
+                        } else {
+                            lexer_structural_index_add( &index, LEXER_STRUCTURAL_TERMINATOR, i, i + length, line, depth, punct );
+                        }
+                        skip = i + length;
+                    }
+                    break;
+
+                case IN_STRING:
+                case IN_CHARACTER:
+                    if ( cls & LEXER_CLASS_NEWLINE ) {
+                        line += 1;
+                    } else if ( cls & LEXER_CLASS_ESCAPE ) {
+                        skip = i + 2;
+                    } else if ( state == IN_STRING && ( cls & LEXER_CLASS_QUOTE ) && !memcmp( source + i, delimiter, delimiter_size ) ) {
+                        lexer_structural_index_add( &index, LEXER_STRUCTURAL_STRING, start, i + delimiter_size, start_line, depth, 0 );
+                        state = IN_CODE;
+                        skip = i + delimiter_size;
+                    } else if ( state == IN_CHARACTER && ( cls & LEXER_CLASS_CHAR_QUOTE ) ) {
+                        lexer_structural_index_add( &index, LEXER_STRUCTURAL_CHARACTER, start, i + 1, start_line, depth, 0 );
+                        state = IN_CODE;
+                    }
+                    break;
+
+                case IN_LINE_COMMENT:
+                    if ( cls & LEXER_CLASS_NEWLINE ) {
+                        lexer_structural_index_add( &index, LEXER_STRUCTURAL_COMMENT, start, i, start_line, depth, 0 );
+                        state = IN_CODE;
+                        line += 1;
+                    }
+                    break;
+
+                case IN_MULTILINE_COMMENT:
+                    if ( cls & LEXER_CLASS_NEWLINE ) {
+                        line += 1;
+                    } else if ( ( cls & LEXER_CLASS_COMMENT ) && !memcmp( source + i, LEXER_MULTILINE_COMMENT_CLOSE, strlen( LEXER_MULTILINE_COMMENT_CLOSE ) ) ) {
+                        skip = i + strlen( LEXER_MULTILINE_COMMENT_CLOSE );
+                        lexer_structural_index_add( &index, LEXER_STRUCTURAL_COMMENT, start, skip, start_line, depth, 0 );
+                        state = IN_CODE;
+                    }
+                    break;
+                }
+            }
+        }
+
+        // whatever is still open runs to the end of the source
+        if ( state == IN_STRING ) {
+            lexer_structural_index_add( &index, LEXER_STRUCTURAL_STRING, start, size, start_line, depth, 0 );
+        } else if ( state == IN_CHARACTER ) {
+            lexer_structural_index_add( &index, LEXER_STRUCTURAL_CHARACTER, start, size, start_line, depth, 0 );
+        } else if ( state != IN_CODE ) {
+            lexer_structural_index_add( &index, LEXER_STRUCTURAL_COMMENT, start, size, start_line, depth, 0 );
+        }
+
+        return index;
+    }
+
+    typedef struct {
+        token_t tokens[LEXER_TOKEN_BATCH_SIZE];
+        size_t length;
+    } token_batch_t;
+
+    // receives up to `LEXER_TOKEN_BATCH_SIZE` tokens at a time. the tokens themselves are only valid until it
+    // returns, string payloads until `lexer_free`
+    typedef void ( *lexer_visitor_t )( void* userdata, token_t* tokens, size_t count );
+
+    // lexes the whole source, handing tokens to `fn( userdata, tokens, count )` in batches of up to
+    // `LEXER_TOKEN_BATCH_SIZE`. tokens are added to `lexer_t.token_list` as usual and dropped again after each
+    // batch, so emitting one costs no indirect call and `fn`, named directly here, can be inlined into the loop
+#define LEXER_PARSE_VISIT( lexer, fn, userdata )                                                            \
+    do {                                                                                                    \
+        lexer_t visit_lexer_ = ( lexer );                                                                   \
+        token_list_t* visit_list_ = &visit_lexer_->token_list;                                              \
+        size_t visit_base_ = visit_list_->length;                                                           \
+        lexer_token_sink_t visit_sink_ = visit_lexer_->sink;                                                \
+        bool visit_unindexed_ = visit_lexer_->unindexed;                                                    \
+        visit_lexer_->sink = NULL;                                                                          \
+        visit_lexer_->unindexed = true;                                                                     \
+        while ( lexer_parse_next( visit_lexer_ ) ) {                                                        \
+            if ( visit_list_->length - visit_base_ == LEXER_TOKEN_BATCH_SIZE ) {                            \
+                fn( ( userdata ), visit_list_->tokens + visit_base_, LEXER_TOKEN_BATCH_SIZE );              \
+                visit_list_->length = visit_base_;                                                          \
+            }                                                                                               \
+        }                                                                                                   \
+        if ( visit_list_->length > visit_base_ ) {                                                          \
+            fn( ( userdata ), visit_list_->tokens + visit_base_, visit_list_->length - visit_base_ );       \
+            visit_list_->length = visit_base_;                                                              \
+        }                                                                                                   \
+        visit_lexer_->sink = visit_sink_;                                                                   \
+        visit_lexer_->unindexed = visit_unindexed_;                                                         \
+    } while ( 0 )
+
+    // `LEXER_PARSE_VISIT` for a visitor only known at runtime, called once per batch
+    void lexer_parse_visit( lexer_t lexer, lexer_visitor_t visitor, void* userdata ) {
+        LEXER_PARSE_VISIT( lexer, visitor, userdata );
+    }
+
+#if LEXER_SUPPORT_PIPELINE
+#define LEXER_CACHE_LINE_SIZE 64
+
+    // single-producer/single-consumer ring of token batches. the lexer thread is the only writer of
+    // `head`, `fill`, `producer_waiting` and `done`, the consumer is the only writer of `tail` and
+    // `consumer_waiting`. each side's fields get their own cache line so publishing doesn't keep stealing
+    // the line the other side is reading
+    typedef struct {
+        lexer_t lexer;
+        pthread_t thread;
+
+        token_batch_t* ring;
+
+        // only touched once a side gives up spinning
+        pthread_mutex_t mutex;
+        pthread_cond_t wake;
+
+        __attribute__(( aligned( LEXER_CACHE_LINE_SIZE ) )) size_t head;
+        size_t fill;
+        bool producer_waiting;
+        bool done;
+
+        __attribute__(( aligned( LEXER_CACHE_LINE_SIZE ) )) size_t tail;
+        bool consumer_waiting;
+    } lexer_pipeline_inner_t, * lexer_pipeline_t;
+
+    // called after storing `head`, `tail` or `done`. those stores and the `waiting` load are sequentially
+    // consistent, as are the waiter's flag store and recheck in `lexer_pipeline_block`, so either the waiter
+    // sees the update or this sees the waiter
+    void lexer_pipeline_wake( lexer_pipeline_t pipeline, bool* waiting ) {
+        if ( __atomic_load_n( waiting, __ATOMIC_SEQ_CST ) ) {
+            pthread_mutex_lock( &pipeline->mutex );
+            pthread_cond_broadcast( &pipeline->wake );
+            pthread_mutex_unlock( &pipeline->mutex );
+        }
+    }
+
+    // yields up to `LEXER_PIPELINE_SPIN_LIMIT` times, then sleeps until `ready` holds
+    void lexer_pipeline_block( lexer_pipeline_t pipeline, bool ( *ready )( lexer_pipeline_t ), bool* waiting ) {
+        for ( int i = 0; i < LEXER_PIPELINE_SPIN_LIMIT; i++ ) {
+            if ( ready( pipeline ) ) {
+                return;
+            }
+            sched_yield();
+        }
+
+        pthread_mutex_lock( &pipeline->mutex );
+        __atomic_store_n( waiting, true, __ATOMIC_SEQ_CST );
+        while ( !ready( pipeline ) ) {
+            pthread_cond_wait( &pipeline->wake, &pipeline->mutex );
+        }
+        __atomic_store_n( waiting, false, __ATOMIC_RELAXED );
+        pthread_mutex_unlock( &pipeline->mutex );
+    }
+
+    bool lexer_pipeline_has_room( lexer_pipeline_t pipeline ) {
+        return pipeline->head - __atomic_load_n( &pipeline->tail, __ATOMIC_SEQ_CST ) < LEXER_PIPELINE_RING_SIZE;
+    }
+
+    bool lexer_pipeline_has_batch( lexer_pipeline_t pipeline ) {
+        return __atomic_load_n( &pipeline->head, __ATOMIC_SEQ_CST ) != pipeline->tail
+            || __atomic_load_n( &pipeline->done, __ATOMIC_SEQ_CST );
+    }
+
+    void lexer_pipeline_publish( lexer_pipeline_t pipeline ) {
+        pipeline->ring[pipeline->head % LEXER_PIPELINE_RING_SIZE].length = pipeline->fill;
+        pipeline->fill = 0;
+        __atomic_store_n( &pipeline->head, pipeline->head + 1, __ATOMIC_SEQ_CST );
+        lexer_pipeline_wake( pipeline, &pipeline->consumer_waiting );
+    }
+
+    void lexer_pipeline_sink( void* userdata, token_t* token ) {
+        lexer_pipeline_t pipeline = (lexer_pipeline_t)userdata;
+
+        if ( pipeline->fill == 0 && !lexer_pipeline_has_room( pipeline ) ) {
+            lexer_pipeline_block( pipeline, lexer_pipeline_has_room, &pipeline->producer_waiting );
+        }
+
+        token_batch_t* batch = &pipeline->ring[pipeline->head % LEXER_PIPELINE_RING_SIZE];
+        batch->tokens[pipeline->fill] = *token;
+        pipeline->fill += 1;
+
+        if ( pipeline->fill == LEXER_TOKEN_BATCH_SIZE ) {
+            lexer_pipeline_publish( pipeline );
+        }
+    }
+
+    void* lexer_pipeline_worker( void* userdata ) {
+        lexer_pipeline_t pipeline = (lexer_pipeline_t)userdata;
+
+        lexer_parse( pipeline->lexer );
+        if ( pipeline->fill ) {
+            lexer_pipeline_publish( pipeline );
+        }
+
+        __atomic_store_n( &pipeline->done, true, __ATOMIC_SEQ_CST );
+        lexer_pipeline_wake( pipeline, &pipeline->consumer_waiting );
+        return NULL;
+    }
+
+    // starts lexing `lexer` on its own thread. tokens are handed out in batches through
+    // `lexer_pipeline_poll`/`lexer_pipeline_wait` and are never added to `lexer_t.token_list`
+    lexer_pipeline_t lexer_pipeline_start( lexer_t lexer ) {
+        lexer_pipeline_inner_t* pipeline = (lexer_pipeline_inner_t*)aligned_alloc( LEXER_CACHE_LINE_SIZE, sizeof( lexer_pipeline_inner_t ) );
+        if ( !pipeline ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for lexer_pipeline_t\n" );
+            exit( EXIT_FAILURE );
+        }
+        memset( (void*)pipeline, 0, sizeof( lexer_pipeline_inner_t ) );
+        pthread_mutex_init( &pipeline->mutex, NULL );
+        pthread_cond_init( &pipeline->wake, NULL );
+
+        pipeline->ring = (token_batch_t*)calloc( LEXER_PIPELINE_RING_SIZE, sizeof( token_batch_t ) );
+        if ( !pipeline->ring ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for lexer_pipeline_t.ring\n" );
+            exit( EXIT_FAILURE );
+        }
+
+        pipeline->lexer = lexer;
+        lexer->sink = lexer_pipeline_sink;
+        lexer->sink_userdata = pipeline;
+
+        if ( pthread_create( &pipeline->thread, NULL, lexer_pipeline_worker, pipeline ) != 0 ) {
+            fprintf( stderr, "[FATAL]: could not start lexer pipeline thread\n" );
+            exit( EXIT_FAILURE );
+        }
+
+        return pipeline;
+    }
+
+    // true once the lexer thread has finished and every batch has been consumed
+    bool lexer_pipeline_finished( lexer_pipeline_t pipeline ) {
+        bool done = __atomic_load_n( &pipeline->done, __ATOMIC_ACQUIRE );
+        return done && __atomic_load_n( &pipeline->head, __ATOMIC_ACQUIRE ) == pipeline->tail;
+    }
+
+    // returns the oldest published batch without blocking, or NULL if none is ready yet
+    const token_batch_t* lexer_pipeline_poll( lexer_pipeline_t pipeline ) {
+        if ( __atomic_load_n( &pipeline->head, __ATOMIC_ACQUIRE ) == pipeline->tail ) {
+            return NULL;
+        }
+        return &pipeline->ring[pipeline->tail % LEXER_PIPELINE_RING_SIZE];
+    }
+
+    // blocks until a batch is ready. returns NULL once the whole source has been consumed
+    const token_batch_t* lexer_pipeline_wait( lexer_pipeline_t pipeline ) {
+        if ( !lexer_pipeline_has_batch( pipeline ) ) {
+            lexer_pipeline_block( pipeline, lexer_pipeline_has_batch, &pipeline->consumer_waiting );
+        }
+        return lexer_pipeline_poll( pipeline );
+    }
+
+    // hands the batch returned by `lexer_pipeline_poll`/`lexer_pipeline_wait` back to the lexer thread.
+    // the slot is reused afterwards, so copy out any tokens that need to outlive it. string payloads stay valid
+    // until `lexer_free`
+    void lexer_pipeline_release( lexer_pipeline_t pipeline ) {
+        __atomic_store_n( &pipeline->tail, pipeline->tail + 1, __ATOMIC_SEQ_CST );
+        lexer_pipeline_wake( pipeline, &pipeline->producer_waiting );
+    }
+
+    // drains any unconsumed batches, joins the lexer thread and frees the pipeline
+    void lexer_pipeline_join( lexer_pipeline_t pipeline ) {
+        while ( lexer_pipeline_wait( pipeline ) ) {
+            lexer_pipeline_release( pipeline );
+        }
+
+        pthread_join( pipeline->thread, NULL );
+
+        pipeline->lexer->sink = NULL;
+        pipeline->lexer->sink_userdata = NULL;
+
+        pthread_mutex_destroy( &pipeline->mutex );
+        pthread_cond_destroy( &pipeline->wake );
+        free( (void*)pipeline->ring );
+        free( (void*)pipeline );
+    }
+#endif // LEXER_SUPPORT_PIPELINE
+
+#if LEXER_SUPPORT_FILE_SET
+    // called once per file, in whatever order the reads complete, with a lexer that has already parsed it.
+    // the lexer is freed and its buffer reused as soon as this returns
+    typedef void ( *lexer_file_callback_t )( void* userdata, size_t index, lexer_t lexer );
+
+    typedef struct {
+        char* buffer;
+        size_t capacity;
+
+        size_t index;
+        size_t size;
+        size_t done;
+        int fd;
+
+        struct iovec iov;
+        bool ready;
+    } lexer_file_slot_t;
+
+    // opens `paths[index]` into `slot`, making sure its buffer fits the file plus the zeroed padding.
+    // returns false for empty files, which have nothing to read
+    bool lexer_file_open( lexer_file_slot_t* slot, size_t index, const char* path ) {
+        slot->fd = open( path, O_RDONLY );
+        if ( slot->fd < 0 ) {
+            fprintf( stderr, "[FATAL]: could not open `%s`: %s\n", path, strerror( errno ) );
+            exit( EXIT_FAILURE );
+        }
+
+        struct stat st;
+        if ( fstat( slot->fd, &st ) != 0 ) {
+            fprintf( stderr, "[FATAL]: could not stat `%s`: %s\n", path, strerror( errno ) );
+            exit( EXIT_FAILURE );
+        }
+
+        slot->index = index;
+        slot->size = (size_t)st.st_size;
+        slot->done = 0;
+
+        if ( slot->capacity < slot->size + LEXER_INPUT_PADDING ) {
+            free( (void*)slot->buffer );
+            slot->buffer = lexer_alloc_padded( slot->size );
+            slot->capacity = slot->size + LEXER_INPUT_PADDING;
+        } else {
+            memset( slot->buffer + slot->size, 0, LEXER_INPUT_PADDING );
+        }
+
+        if ( slot->size == 0 ) {
+            close( slot->fd );
+            slot->fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    // accounts for `bytes` more bytes read, returns true once the whole file is in the buffer
+    bool lexer_file_advance( lexer_file_slot_t* slot, size_t bytes ) {
+        slot->done += bytes;
+
+        // the file shrank since it was opened
+        if ( bytes == 0 && slot->done < slot->size ) {
+            slot->size = slot->done;
+            memset( slot->buffer + slot->size, 0, LEXER_INPUT_PADDING );
+        }
+
+        if ( slot->done < slot->size ) {
+            return false;
+        }
+
+        close( slot->fd );
+        slot->fd = -1;
+        return true;
+    }
+
+    void lexer_file_finish( lexer_file_slot_t* slot, lexer_file_callback_t callback, void* userdata ) {
+        lexer_t lexer = lexer_create_from_padded( slot->buffer, slot->size );
+        lexer_parse( lexer );
+        callback( userdata, slot->index, lexer );
+        lexer_free( lexer );
+    }
+
+# if LEXER_HAS_IO_URING
+    typedef struct {
+        int fd;
+
+        unsigned* sq_tail;
+        unsigned* sq_mask;
+        unsigned* sq_array;
+        struct io_uring_sqe* sqes;
+
+        unsigned* cq_head;
+        unsigned* cq_tail;
+        unsigned* cq_mask;
+        struct io_uring_cqe* cqes;
+
+        void* sq_ring;
+        size_t sq_ring_size;
+        void* cq_ring;
+        size_t cq_ring_size;
+        size_t sqes_size;
+    } lexer_uring_t;
+
+    // returns false when io_uring isn't available, e.g. on older kernels or under seccomp
+    bool lexer_uring_init( lexer_uring_t* ring, unsigned entries ) {
+        struct io_uring_params params;
+        memset( &params, 0, sizeof( params ) );
+
+        ring->fd = (int)syscall( __NR_io_uring_setup, entries, &params );
+        if ( ring->fd < 0 ) {
+            return false;
+        }
+
+        ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+        ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+        bool single_mmap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+        if ( single_mmap ) {
+            if ( ring->cq_ring_size > ring->sq_ring_size ) ring->sq_ring_size = ring->cq_ring_size;
+            ring->cq_ring_size = ring->sq_ring_size;
+        }
+
+        ring->sq_ring = mmap( NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+        ring->cq_ring = single_mmap ? ring->sq_ring : mmap( NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+        ring->sqes_size = params.sq_entries * sizeof( struct io_uring_sqe );
+        ring->sqes = (struct io_uring_sqe*)mmap( NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES );
+        if ( ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || (void*)ring->sqes == MAP_FAILED ) {
+            fprintf( stderr, "[FATAL]: could not map io_uring rings: %s\n", strerror( errno ) );
+            exit( EXIT_FAILURE );
+        }
+
+        char* sq = (char*)ring->sq_ring;
+        ring->sq_tail = (unsigned*)( sq + params.sq_off.tail );
+        ring->sq_mask = (unsigned*)( sq + params.sq_off.ring_mask );
+        ring->sq_array = (unsigned*)( sq + params.sq_off.array );
+
+        char* cq = (char*)ring->cq_ring;
+        ring->cq_head = (unsigned*)( cq + params.cq_off.head );
+        ring->cq_tail = (unsigned*)( cq + params.cq_off.tail );
+        ring->cq_mask = (unsigned*)( cq + params.cq_off.ring_mask );
+        ring->cqes = (struct io_uring_cqe*)( cq + params.cq_off.cqes );
+
+        return true;
+    }
+
+    void lexer_uring_free( lexer_uring_t* ring ) {
+        munmap( (void*)ring->sqes, ring->sqes_size );
+        if ( ring->cq_ring != ring->sq_ring ) {
+            munmap( ring->cq_ring, ring->cq_ring_size );
+        }
+        munmap( ring->sq_ring, ring->sq_ring_size );
+        close( ring->fd );
+    }
+
+    // queues a read of whatever is still missing from `slot`, tagged with its position in the slot array
+    void lexer_uring_read( lexer_uring_t* ring, lexer_file_slot_t* slot, size_t tag ) {
+        size_t remaining = slot->size - slot->done;
+        slot->iov.iov_base = slot->buffer + slot->done;
+        slot->iov.iov_len = remaining < ( (size_t)1 << 30 ) ? remaining : ( (size_t)1 << 30 );
+
+        unsigned tail = *ring->sq_tail;
+        unsigned index = tail & *ring->sq_mask;
+
+        struct io_uring_sqe* sqe = &ring->sqes[index];
+        memset( sqe, 0, sizeof( *sqe ) );
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = slot->fd;
+        sqe->addr = (uint64_t)(uintptr_t)&slot->iov;
+        sqe->len = 1;
+        sqe->off = slot->done;
+        sqe->user_data = tag;
+
+        ring->sq_array[index] = index;
+        __atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+        while ( syscall( __NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0 ) < 0 ) {
+            if ( errno != EINTR ) {
+                fprintf( stderr, "[FATAL]: could not submit io_uring read: %s\n", strerror( errno ) );
+                exit( EXIT_FAILURE );
+            }
+        }
+    }
+
+    // waits for the next completion, returning its tag and result
+    size_t lexer_uring_wait( lexer_uring_t* ring, int32_t* result ) {
+        while ( 1 ) {
+            unsigned head = *ring->cq_head;
+            if ( head != __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE ) ) {
+                const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+                size_t tag = (size_t)cqe->user_data;
+                *result = cqe->res;
+                __atomic_store_n( ring->cq_head, head + 1, __ATOMIC_RELEASE );
+                return tag;
+            }
+
+            if ( syscall( __NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 ) < 0 && errno != EINTR ) {
+                fprintf( stderr, "[FATAL]: could not wait for io_uring completions: %s\n", strerror( errno ) );
+                exit( EXIT_FAILURE );
+            }
+        }
+    }
+
+    // opens the next file into `slot` and queues its read. empty files are handed straight to the callback.
+    // returns false once there are no files left
+    bool lexer_uring_start( lexer_uring_t* ring, lexer_file_slot_t* slots, size_t tag, const char* const* paths, size_t count, size_t* next, lexer_file_callback_t callback, void* userdata ) {
+        lexer_file_slot_t* slot = &slots[tag];
+        while ( *next < count ) {
+            bool has_contents = lexer_file_open( slot, *next, paths[*next] );
+            *next += 1;
+
+            if ( has_contents ) {
+                lexer_uring_read( ring, slot, tag );
+                return true;
+            }
+            lexer_file_finish( slot, callback, userdata );
+        }
+        return false;
+    }
+
+    bool lexer_parse_files_uring( const char* const* paths, size_t count, lexer_file_slot_t* slots, size_t in_flight, lexer_file_callback_t callback, void* userdata ) {
+        lexer_uring_t ring;
+        if ( !lexer_uring_init( &ring, (unsigned)in_flight ) ) {
+            return false;
+        }
+
+        size_t next = 0;
+        size_t active = 0;
+        for ( size_t i = 0; i < in_flight; i++ ) {
+            active += lexer_uring_start( &ring, slots, i, paths, count, &next, callback, userdata );
+        }
+
+        while ( active ) {
+            int32_t result;
+            size_t tag = lexer_uring_wait( &ring, &result );
+            lexer_file_slot_t* slot = &slots[tag];
+            if ( result < 0 ) {
+                fprintf( stderr, "[FATAL]: could not read `%s`: %s\n", paths[slot->index], strerror( -result ) );
+                exit( EXIT_FAILURE );
+            }
+
+            if ( !lexer_file_advance( slot, (size_t)result ) ) {
+                lexer_uring_read( &ring, slot, tag );
+                continue;
+            }
+
+            // the other reads keep going while this file is lexed
+            lexer_file_finish( slot, callback, userdata );
+            if ( !lexer_uring_start( &ring, slots, tag, paths, count, &next, callback, userdata ) ) {
+                active -= 1;
+            }
+        }
+
+        lexer_uring_free( &ring );
+        return true;
+    }
+# endif // LEXER_HAS_IO_URING
+
+    typedef struct {
+        const char* const* paths;
+        size_t count;
+        size_t next;
+
+        size_t readers;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+    } lexer_file_set_t;
+
+    typedef struct {
+        lexer_file_set_t* set;
+        lexer_file_slot_t* slot;
+        pthread_t thread;
+    } lexer_file_reader_t;
+
+    // blocking fallback: each reader thread fills its own slot, then waits for the lexing thread to recycle it
+    void* lexer_file_reader( void* userdata ) {
+        lexer_file_reader_t* reader = (lexer_file_reader_t*)userdata;
+        lexer_file_set_t* set = reader->set;
+        lexer_file_slot_t* slot = reader->slot;
+
+        while ( 1 ) {
+            size_t index = __atomic_fetch_add( &set->next, 1, __ATOMIC_RELAXED );
+            if ( index >= set->count ) {
+                break;
+            }
+
+            for ( bool complete = !lexer_file_open( slot, index, set->paths[index] ); !complete; ) {
+                ssize_t n = read( slot->fd, slot->buffer + slot->done, slot->size - slot->done );
+                if ( n < 0 ) {
+                    if ( errno == EINTR ) continue;
+                    fprintf( stderr, "[FATAL]: could not read `%s`: %s\n", set->paths[index], strerror( errno ) );
+                    exit( EXIT_FAILURE );
+                }
+                complete = lexer_file_advance( slot, (size_t)n );
+            }
+
+            pthread_mutex_lock( &set->mutex );
+            slot->ready = true;
+            pthread_cond_broadcast( &set->cond );
+            while ( slot->ready ) {
+                pthread_cond_wait( &set->cond, &set->mutex );
+            }
+            pthread_mutex_unlock( &set->mutex );
+        }
+
+        pthread_mutex_lock( &set->mutex );
+        set->readers -= 1;
+        pthread_cond_broadcast( &set->cond );
+        pthread_mutex_unlock( &set->mutex );
+        return NULL;
+    }
+
+    void lexer_parse_files_threaded( const char* const* paths, size_t count, lexer_file_slot_t* slots, size_t in_flight, lexer_file_callback_t callback, void* userdata ) {
+        lexer_file_set_t set;
+        set.paths = paths;
+        set.count = count;
+        set.next = 0;
+        set.readers = in_flight;
+        pthread_mutex_init( &set.mutex, NULL );
+        pthread_cond_init( &set.cond, NULL );
+
+        lexer_file_reader_t* readers = (lexer_file_reader_t*)calloc( in_flight, sizeof( lexer_file_reader_t ) );
+        if ( !readers ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for lexer file readers\n" );
+            exit( EXIT_FAILURE );
+        }
+
+        for ( size_t i = 0; i < in_flight; i++ ) {
+            readers[i].set = &set;
+            readers[i].slot = &slots[i];
+            if ( pthread_create( &readers[i].thread, NULL, lexer_file_reader, &readers[i] ) != 0 ) {
+                fprintf( stderr, "[FATAL]: could not start lexer file reader thread\n" );
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        pthread_mutex_lock( &set.mutex );
+        while ( 1 ) {
+            lexer_file_slot_t* ready = NULL;
+            for ( size_t i = 0; i < in_flight && !ready; i++ ) {
+                if ( slots[i].ready ) ready = &slots[i];
+            }
+
+            if ( ready ) {
+                pthread_mutex_unlock( &set.mutex );
+                lexer_file_finish( ready, callback, userdata );
+                pthread_mutex_lock( &set.mutex );
+
+                ready->ready = false;
+                pthread_cond_broadcast( &set.cond );
+            } else if ( set.readers == 0 ) {
+                break;
+            } else {
+                pthread_cond_wait( &set.cond, &set.mutex );
+            }
+        }
+        pthread_mutex_unlock( &set.mutex );
+
+        for ( size_t i = 0; i < in_flight; i++ ) {
+            pthread_join( readers[i].thread, NULL );
+        }
+
+        free( (void*)readers );
+        pthread_cond_destroy( &set.cond );
+        pthread_mutex_destroy( &set.mutex );
+    }
+
+    // lexes every file in `paths`, keeping at most `in_flight` reads outstanding while earlier files are
+    // being lexed. reads go through io_uring when available and through blocking reader threads otherwise
+    void lexer_parse_files( const char* const* paths, size_t count, size_t in_flight, lexer_file_callback_t callback, void* userdata ) {
+        if ( in_flight == 0 ) {
+            in_flight = 1;
+        }
+        if ( in_flight > count ) {
+            in_flight = count ? count : 1;
+        }
+        // each slot is a ring entry or a reader thread, so don't let a large request spawn thousands of threads
+        if ( in_flight > LEXER_FILE_SET_MAX_IN_FLIGHT ) {
+            in_flight = LEXER_FILE_SET_MAX_IN_FLIGHT;
+        }
+
+        lexer_file_slot_t* slots = (lexer_file_slot_t*)calloc( in_flight, sizeof( lexer_file_slot_t ) );
+        if ( !slots ) {
+            fprintf( stderr, "[FATAL]: could not allocate memory for lexer file slots\n" );
+            exit( EXIT_FAILURE );
+        }
+
+    # if LEXER_HAS_IO_URING
+        if ( !lexer_parse_files_uring( paths, count, slots, in_flight, callback, userdata ) )
+    # endif // LEXER_HAS_IO_URING
+        {
+            lexer_parse_files_threaded( paths, count, slots, in_flight, callback, userdata );
+        }
+
+        for ( size_t i = 0; i < in_flight; i++ ) {
+            free( (void*)slots[i].buffer );
+        }
+        free( (void*)slots );
+    }
+#endif // LEXER_SUPPORT_FILE_SET
 
 #undef LEXER_OPERATOR_LIST
 #undef LEXER_PUNCTUATION_LIST
 #undef LEXER_KEYWORD_LIST
+#undef LEXER_BRACKET_LIST
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,875 @@
+#pragma once
+
+#ifndef LEXER_HPP
+#define LEXER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lexer.def"
+
+namespace lexer {
+
+    enum class token_type {
+        error,
+        op,
+        integer,
+        punctuation,
+        keyword,
+        character,
+        string,
+        float_,
+        double_,
+        identifier,
+    };
+
+    struct symbol {
+        std::string_view text;
+        int id;
+    };
+
+    enum class escape_kind {
+        fixed,
+        hex,
+        unicode16,
+        unicode32,
+        octal,
+        custom,
+        unhandled,
+    };
+
+    // a user supplied escape handler. `cursor` starts just past the escape character and the character that
+    // selected the handler (or just past the escape character for a fallback, with `is_fallback` set) and is
+    // left after the last character of the sequence. returns the codepoint, or throws `lexer::error`
+    using escape_fn = std::uint64_t ( * )( const char*& cursor, bool is_fallback );
+
+    // `c == '\0'` marks the fallback used for any escape character not listed
+    struct escape {
+        char c;
+        std::uint32_t value;
+        escape_kind kind;
+        escape_fn fn = nullptr;
+    };
+
+    struct token {
+        token_type type = token_type::error;
+
+        std::size_t line = 0;
+        std::size_t column = 0;
+
+        std::string_view lexeme;
+
+        // utf-8 contents of string literals and identifiers. borrowed from the source unless unescaped
+        std::string_view text;
+
+        union {
+            std::uint64_t i = 0;
+            int id;
+            double d;
+            float f;
+        };
+    };
+
+    class error : public std::runtime_error {
+    public:
+        error( const std::string& message, std::size_t line, std::size_t column )
+            : std::runtime_error( message + " at " + std::to_string( line ) + ":" + std::to_string( column ) ), line( line ), column( column ) {}
+
+        std::size_t line;
+        std::size_t column;
+    };
+
+    namespace detail {
+
+        enum : std::uint16_t {
+            CLASS_SPACE = 1 << 0,
+            CLASS_NEWLINE = 1 << 1,
+            CLASS_RETURN = 1 << 2,
+            CLASS_COMMENT = 1 << 3,
+            CLASS_QUOTE = 1 << 4,
+            CLASS_CHAR_QUOTE = 1 << 5,
+            CLASS_DIGIT = 1 << 6,
+            CLASS_SYMBOL = 1 << 7,
+            CLASS_IDENT_START = 1 << 8,
+            CLASS_IDENT = 1 << 9,
+            CLASS_HEX_DIGIT = 1 << 10,
+        };
+
+        constexpr escape make_escape( char c, escape_kind kind ) {
+            return escape { c, 0, kind };
+        }
+
+        constexpr escape make_escape( char c, escape_fn fn ) {
+            return escape { c, 0, escape_kind::custom, fn };
+        }
+
+        struct symbol_entry {
+            std::string_view text;
+            int id;
+            token_type type;
+        };
+
+        struct bucket {
+            std::uint16_t first;
+            std::uint16_t count;
+        };
+
+        constexpr std::uint32_t hash( std::string_view text ) {
+            std::uint32_t h = 2166136261u;
+            for ( char c : text ) {
+                h = ( h ^ (unsigned char)c ) * 16777619u;
+            }
+            return h;
+        }
+
+        constexpr std::size_t table_size( std::size_t count ) {
+            std::size_t size = 1;
+            while ( size < count * 2 ) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        // calls `fn` for each entry of a space separated list such as "0x 0X"
+        template <typename Fn>
+        constexpr void for_each_option( std::string_view options, Fn fn ) {
+            std::size_t i = 0;
+            while ( i < options.size() ) {
+                while ( i < options.size() && options[i] == ' ' ) { i++; }
+                std::size_t start = i;
+                while ( i < options.size() && options[i] != ' ' ) { i++; }
+                if ( i > start ) {
+                    fn( options.substr( start, i - start ) );
+                }
+            }
+        }
+
+        constexpr std::size_t longest_option( std::string_view options ) {
+            std::size_t longest = 0;
+            for_each_option( options, [&]( std::string_view option ) {
+                if ( option.size() > longest ) longest = option.size();
+            } );
+            return longest;
+        }
+
+        inline bool starts_with( const char* str, std::string_view prefix ) {
+            return std::memcmp( str, prefix.data(), prefix.size() ) == 0;
+        }
+
+        inline std::size_t match_any( const char* str, std::string_view options ) {
+            std::size_t matched = 0;
+            for_each_option( options, [&]( std::string_view option ) {
+                if ( !matched && starts_with( str, option ) ) matched = option.size();
+            } );
+            return matched;
+        }
+
+        template <typename Config>
+        constexpr std::array<std::uint16_t, 256> make_classes() {
+            std::array<std::uint16_t, 256> classes {};
+
+            for ( int c = 0; c < 256; c++ ) {
+                bool alpha = ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || c == '_';
+                bool digit = c >= '0' && c <= '9';
+                bool hex = digit || ( c >= 'a' && c <= 'f' ) || ( c >= 'A' && c <= 'F' );
+                if ( alpha ) classes[c] |= CLASS_IDENT_START | CLASS_IDENT;
+                if ( digit ) classes[c] |= CLASS_DIGIT | CLASS_IDENT;
+                if ( hex ) classes[c] |= CLASS_HEX_DIGIT;
+            }
+
+            classes[(unsigned char)' '] |= CLASS_SPACE;
+            classes[(unsigned char)'\t'] |= CLASS_SPACE;
+            classes[(unsigned char)'\n'] |= CLASS_NEWLINE;
+            classes[(unsigned char)'\r'] |= CLASS_RETURN;
+
+            classes[(unsigned char)Config::line_comment[0]] |= CLASS_COMMENT;
+            classes[(unsigned char)Config::multiline_comment_open[0]] |= CLASS_COMMENT;
+            for_each_option( Config::string_delimiters, [&]( std::string_view delimiter ) {
+                classes[(unsigned char)delimiter[0]] |= CLASS_QUOTE;
+            } );
+            classes[(unsigned char)Config::char_delimiter] |= CLASS_CHAR_QUOTE;
+
+            for ( const symbol& s : Config::operators ) classes[(unsigned char)s.text[0]] |= CLASS_SYMBOL;
+            for ( const symbol& s : Config::punctuation ) classes[(unsigned char)s.text[0]] |= CLASS_SYMBOL;
+
+            return classes;
+        }
+
+        // operators and punctuation in one array, grouped by first byte. within a group operators come
+        // before punctuation and longer symbols before shorter ones, so the first match is the one to take
+        template <typename Config>
+        constexpr auto make_symbols() {
+            constexpr std::size_t count = Config::operators.size() + Config::punctuation.size();
+            std::array<symbol_entry, count> symbols {};
+
+            std::size_t n = 0;
+            for ( const symbol& s : Config::operators ) symbols[n++] = symbol_entry { s.text, s.id, token_type::op };
+            for ( const symbol& s : Config::punctuation ) symbols[n++] = symbol_entry { s.text, s.id, token_type::punctuation };
+
+            auto before = []( const symbol_entry& a, const symbol_entry& b ) {
+                unsigned char fa = (unsigned char)a.text[0], fb = (unsigned char)b.text[0];
+                if ( fa != fb ) return fa < fb;
+                if ( a.type != b.type ) return a.type == token_type::op;
+                return a.text.size() > b.text.size();
+            };
+
+            for ( std::size_t i = 1; i < count; i++ ) {
+                symbol_entry entry = symbols[i];
+                std::size_t j = i;
+                for ( ; j > 0 && before( entry, symbols[j - 1] ); j-- ) {
+                    symbols[j] = symbols[j - 1];
+                }
+                symbols[j] = entry;
+            }
+
+            return symbols;
+        }
+
+        template <std::size_t N>
+        constexpr std::array<bucket, 256> make_buckets( const std::array<symbol_entry, N>& symbols ) {
+            std::array<bucket, 256> buckets {};
+            for ( std::size_t i = 0; i < N; i++ ) {
+                bucket& b = buckets[(unsigned char)symbols[i].text[0]];
+                if ( b.count == 0 ) b.first = (std::uint16_t)i;
+                b.count += 1;
+            }
+            return buckets;
+        }
+
+        // keywords grouped by first byte, longest first, for dialects that match them as prefixes
+        template <typename Config>
+        constexpr auto make_keyword_prefixes() {
+            constexpr std::size_t count = Config::keywords.size();
+            std::array<symbol_entry, count> keywords {};
+
+            for ( std::size_t i = 0; i < count; i++ ) {
+                symbol_entry entry { Config::keywords[i].text, Config::keywords[i].id, token_type::keyword };
+
+                std::size_t j = i;
+                for ( ; j > 0; j-- ) {
+                    const symbol_entry& prev = keywords[j - 1];
+                    unsigned char fa = (unsigned char)entry.text[0], fb = (unsigned char)prev.text[0];
+                    if ( fa > fb || ( fa == fb && entry.text.size() <= prev.text.size() ) ) {
+                        break;
+                    }
+                    keywords[j] = prev;
+                }
+                keywords[j] = entry;
+            }
+
+            return keywords;
+        }
+
+        // open addressing table of keyword index + 1, 0 marks an empty slot
+        template <typename Config>
+        constexpr auto make_keywords() {
+            constexpr std::size_t size = table_size( Config::keywords.size() );
+            std::array<std::uint16_t, size> table {};
+
+            for ( std::size_t i = 0; i < Config::keywords.size(); i++ ) {
+                std::size_t slot = hash( Config::keywords[i].text ) & ( size - 1 );
+                while ( table[slot] ) {
+                    slot = ( slot + 1 ) & ( size - 1 );
+                }
+                table[slot] = (std::uint16_t)( i + 1 );
+            }
+
+            return table;
+        }
+
+        template <typename Config>
+        constexpr std::array<escape, 257> make_escapes() {
+            std::array<escape, 257> escapes {};
+            for ( escape& e : escapes ) e.kind = escape_kind::unhandled;
+
+            for ( const escape& e : Config::escapes ) {
+                escapes[e.c ? (unsigned char)e.c : 256] = e;
+            }
+            return escapes;
+        }
+
+        template <typename Config>
+        constexpr std::size_t make_lookahead() {
+            std::size_t longest = 8;
+            auto fit = [&]( std::size_t n ) { if ( n > longest ) longest = n; };
+
+            for ( const symbol& s : Config::operators ) fit( s.text.size() );
+            for ( const symbol& s : Config::punctuation ) fit( s.text.size() );
+            fit( Config::line_comment.size() );
+            fit( Config::multiline_comment_open.size() );
+            fit( Config::multiline_comment_close.size() );
+            fit( longest_option( Config::string_delimiters ) );
+            fit( longest_option( Config::hex_prefixes ) );
+            fit( longest_option( Config::oct_prefixes ) );
+            fit( longest_option( Config::bin_prefixes ) );
+            fit( longest_option( Config::hex_suffixes ) );
+            fit( longest_option( Config::oct_suffixes ) );
+            fit( longest_option( Config::bin_suffixes ) );
+            fit( longest_option( Config::float_suffixes ) );
+
+            return longest + 1;
+        }
+
+        // everything the hot loop looks up, built once per configuration at compile time
+        template <typename Config>
+        struct tables {
+            static constexpr std::array<std::uint16_t, 256> classes = make_classes<Config>();
+            static constexpr auto symbols = make_symbols<Config>();
+            static constexpr std::array<bucket, 256> buckets = make_buckets( symbols );
+            static constexpr auto keywords = make_keywords<Config>();
+            static constexpr auto keyword_prefixes = make_keyword_prefixes<Config>();
+            static constexpr std::array<bucket, 256> keyword_buckets = make_buckets( keyword_prefixes );
+            static constexpr std::array<escape, 257> escapes = make_escapes<Config>();
+            static constexpr std::size_t lookahead = make_lookahead<Config>();
+        };
+
+        inline std::size_t encode_utf8( char* out, std::uint32_t c ) {
+            if ( c < 0x80 ) {
+                out[0] = (char)c;
+                return 1;
+            }
+
+            std::size_t length = c < 0x800 ? 2 : c < 0x10000 ? 3 : c < 0x200000 ? 4 : c < 0x4000000 ? 5 : 6;
+            for ( std::size_t i = length - 1; i > 0; i-- ) {
+                out[i] = (char)( 0x80 | ( c & 0x3f ) );
+                c >>= 6;
+            }
+            out[0] = (char)( ( 0xff00 >> length ) | c );
+            return length;
+        }
+
+    } // namespace detail
+
+    // a lexer specialised for one dialect. `Config` supplies the dialect as constexpr data, see
+    // `def_config` for the members it needs. tokens are produced on demand while iterating
+    template <typename Config>
+    class basic_lexer {
+        using tables = detail::tables<Config>;
+
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = token;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const token*;
+            using reference = const token&;
+
+            iterator() = default;
+            explicit iterator( basic_lexer* lexer ) : lexer_( lexer ) { ++*this; }
+
+            reference operator*() const { return current_; }
+            pointer operator->() const { return &current_; }
+
+            iterator& operator++() {
+                if ( !lexer_->next( current_ ) ) lexer_ = nullptr;
+                return *this;
+            }
+
+            void operator++( int ) { ++*this; }
+
+            friend bool operator==( const iterator& a, const iterator& b ) { return a.lexer_ == b.lexer_; }
+            friend bool operator!=( const iterator& a, const iterator& b ) { return a.lexer_ != b.lexer_; }
+
+        private:
+            basic_lexer* lexer_ = nullptr;
+            token current_;
+        };
+
+        explicit basic_lexer( std::string_view source )
+            : source_( new char[source.size() + tables::lookahead]() ), size_( source.size() ) {
+            std::memcpy( source_.get(), source.data(), source.size() );
+        }
+
+        basic_lexer( const basic_lexer& ) = delete;
+        basic_lexer& operator=( const basic_lexer& ) = delete;
+        basic_lexer( basic_lexer&& ) noexcept = default;
+        basic_lexer& operator=( basic_lexer&& ) noexcept = default;
+
+        std::string_view source() const { return std::string_view( source_.get(), size_ ); }
+
+        // continues from wherever the previous iteration stopped
+        iterator begin() { return iterator( this ); }
+        iterator end() { return iterator(); }
+
+        std::vector<token> tokenize() {
+            std::vector<token> tokens;
+            for ( token t; next( t ); ) {
+                tokens.push_back( t );
+            }
+            return tokens;
+        }
+
+        // lexes the next token into `out`, returns false at the end of the source
+        bool next( token& out ) {
+            const char* s = source_.get();
+
+            while ( 1 ) {
+                unsigned char c = (unsigned char)s[pos_];
+                std::uint16_t cls = tables::classes[c];
+
+                if ( cls & detail::CLASS_SPACE ) {
+                    pos_ += 1;
+                    continue;
+                }
+
+                if ( cls & ( detail::CLASS_NEWLINE | detail::CLASS_RETURN ) ) {
+                    line_ += ( cls & detail::CLASS_NEWLINE ) != 0;
+                    pos_ += 1;
+                    line_start_ = pos_;
+                    continue;
+                }
+
+                if ( c == '\0' ) {
+                    return false;
+                }
+
+                if ( ( cls & detail::CLASS_COMMENT ) && skip_comment() ) {
+                    continue;
+                }
+
+                out = token();
+                out.line = line_;
+                out.column = pos_ - line_start_ + 1;
+                std::size_t start = pos_;
+
+                std::size_t delimiter_size = 0;
+                if ( ( cls & detail::CLASS_QUOTE ) && ( delimiter_size = detail::match_any( s + pos_, Config::string_delimiters ) ) ) {
+                    lex_string( out, delimiter_size );
+                } else if ( cls & detail::CLASS_CHAR_QUOTE ) {
+                    lex_character( out );
+                } else if ( cls & detail::CLASS_DIGIT ) {
+                    lex_number( out );
+                } else if ( ( cls & detail::CLASS_SYMBOL ) && lex_symbol( out ) ) {
+                } else if ( cls & detail::CLASS_IDENT_START ) {
+                    lex_identifier( out );
+                } else {
+                    fail( std::string( "unhandled token `" ) + (char)c + "`" );
+                }
+
+                out.lexeme = std::string_view( s + start, pos_ - start );
+                return true;
+            }
+        }
+
+    private:
+        [[noreturn]] void fail( const std::string& message ) const {
+            throw error( message, line_, pos_ - line_start_ + 1 );
+        }
+
+        char at( std::size_t offset = 0 ) const {
+            return source_[pos_ + offset];
+        }
+
+        void newline() {
+            line_ += 1;
+            line_start_ = pos_ + 1;
+        }
+
+        // multiline comments are tried first so an opener like "--[[" isn't taken for a line comment
+        bool skip_comment() {
+            const char* s = source_.get();
+
+            if ( detail::starts_with( s + pos_, Config::multiline_comment_open ) ) {
+                std::size_t line = line_, column = pos_ - line_start_ + 1;
+                pos_ += Config::multiline_comment_open.size();
+
+                for ( ; s[pos_] != '\0'; pos_++ ) {
+                    if ( s[pos_] == '\n' ) {
+                        newline();
+                    } else if ( detail::starts_with( s + pos_, Config::multiline_comment_close ) ) {
+                        pos_ += Config::multiline_comment_close.size();
+                        return true;
+                    }
+                }
+
+                throw error( "unclosed multiline comment", line, column );
+            }
+
+            if ( detail::starts_with( s + pos_, Config::line_comment ) ) {
+                while ( s[pos_] != '\n' && s[pos_] != '\0' ) {
+                    pos_ += 1;
+                }
+                return true;
+            }
+
+            return false;
+        }
+
+        bool lex_symbol( token& out ) {
+            detail::bucket b = tables::buckets[(unsigned char)at()];
+            for ( std::size_t i = b.first; i < (std::size_t)b.first + b.count; i++ ) {
+                const detail::symbol_entry& entry = tables::symbols[i];
+                if ( detail::starts_with( source_.get() + pos_, entry.text ) ) {
+                    out.type = entry.type;
+                    out.id = entry.id;
+                    pos_ += entry.text.size();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // the longest keyword starting here, even when it's only the start of a longer identifier
+        bool lex_keyword_prefix( token& out ) {
+            detail::bucket b = tables::keyword_buckets[(unsigned char)at()];
+            for ( std::size_t i = b.first; i < (std::size_t)b.first + b.count; i++ ) {
+                const detail::symbol_entry& entry = tables::keyword_prefixes[i];
+                if ( detail::starts_with( source_.get() + pos_, entry.text ) ) {
+                    out.type = token_type::keyword;
+                    out.id = entry.id;
+                    pos_ += entry.text.size();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void lex_identifier( token& out ) {
+            if constexpr ( Config::keyword_prefixes ) {
+                if ( lex_keyword_prefix( out ) ) {
+                    return;
+                }
+            }
+
+            std::size_t start = pos_;
+            while ( tables::classes[(unsigned char)at()] & detail::CLASS_IDENT ) {
+                pos_ += 1;
+            }
+
+            std::string_view text( source_.get() + start, pos_ - start );
+            constexpr std::size_t mask = tables::keywords.size() - 1;
+            for ( std::size_t slot = detail::hash( text ) & mask; tables::keywords[slot]; slot = ( slot + 1 ) & mask ) {
+                const symbol& keyword = Config::keywords[tables::keywords[slot] - 1];
+                if ( keyword.text == text ) {
+                    out.type = token_type::keyword;
+                    out.id = keyword.id;
+                    return;
+                }
+            }
+
+            out.type = token_type::identifier;
+            out.text = text;
+        }
+
+        std::uint64_t read_digits( std::size_t max, std::size_t min, int base, const char* name ) {
+            char buffer[17] = { 0 };
+            std::size_t n = 0;
+            while ( n < max ) {
+                char c = at( 1 );
+                bool valid = base == 16 ? ( tables::classes[(unsigned char)c] & detail::CLASS_HEX_DIGIT ) != 0 : ( c >= '0' && c <= '7' );
+                if ( !valid ) break;
+                buffer[n++] = c;
+                pos_ += 1;
+            }
+            if ( n < min ) {
+                fail( std::string( "invalid " ) + name + " escape" );
+            }
+            return std::strtoull( buffer, nullptr, base );
+        }
+
+        // `pos_` is on the escape character and is left on the last character of the sequence
+        std::uint64_t unescape() {
+            char c = at( 1 );
+            escape e = tables::escapes[(unsigned char)c];
+            bool fallback = e.kind == escape_kind::unhandled;
+            if ( fallback ) {
+                e = tables::escapes[256];
+            } else {
+                pos_ += 1;
+            }
+
+            switch ( e.kind ) {
+            case escape_kind::fixed: return e.value;
+            case escape_kind::hex: return read_digits( 16, 1, 16, "hex" );
+            case escape_kind::unicode16: return read_digits( 4, 4, 16, "unicode16" );
+            case escape_kind::unicode32: return read_digits( 8, 8, 16, "unicode32" );
+            case escape_kind::octal: return read_digits( 3, fallback ? 1 : 0, 8, "octal" );
+            case escape_kind::custom: {
+                const char* cursor = source_.get() + pos_ + 1;
+                std::uint64_t value = e.fn( cursor, fallback );
+                pos_ = (std::size_t)( cursor - source_.get() ) - 1;
+                return value;
+            }
+            case escape_kind::unhandled: break;
+            }
+            fail( std::string( "invalid escape character `" ) + c + "`" );
+        }
+
+        void lex_character( token& out ) {
+            pos_ += 1;
+            std::uint64_t c = (unsigned char)at();
+            if ( c == (unsigned char)Config::escape_char ) {
+                c = unescape();
+            }
+            pos_ += 1;
+
+            if ( at() != Config::char_delimiter ) {
+                fail( "unterminated char literal" );
+            }
+            pos_ += 1;
+
+            out.type = token_type::character;
+            out.i = c;
+        }
+
+        void lex_string( token& out, std::size_t delimiter_size ) {
+            const char* s = source_.get();
+            std::string_view delimiter( s + pos_, delimiter_size );
+            std::size_t line = line_, column = pos_ - line_start_ + 1;
+            pos_ += delimiter_size;
+
+            // every escape starts at an escape character, takes at least that byte and decodes to at most 6,
+            // whatever the dialect's fixed values or custom handlers produce
+            const char* contents = s + pos_;
+            const char* p = contents;
+            std::size_t escapes = 0;
+            for ( ; *p && !detail::starts_with( p, delimiter ); p++ ) {
+                if ( *p == Config::escape_char && p[1] ) {
+                    escapes += 1 + ( p[1] == Config::escape_char );
+                    p++;
+                }
+            }
+
+            std::size_t raw_length = (std::size_t)( p - contents );
+            std::size_t capacity = raw_length + escapes * 5;
+            char* decoded = escapes ? allocate( capacity ) : nullptr;
+            std::size_t length = 0;
+
+            for ( ; !detail::starts_with( s + pos_, delimiter ); pos_++ ) {
+                char c = s[pos_];
+                if ( c == '\0' || ( c == '\n' && !Config::multiline_strings ) ) {
+                    throw error( "unterminated string starting here (expected `" + std::string( delimiter ) + "`)", line, column );
+                } else if ( c == '\n' ) {
+                    newline();
+                } else if ( c == Config::escape_char ) {
+                    std::uint64_t value = unescape();
+                    if ( value > 0x7fffffff ) {
+                        fail( "codepoint exceeds maximum allowed size for string literals" );
+                    }
+                    length += detail::encode_utf8( decoded + length, (std::uint32_t)value );
+                    continue;
+                }
+
+                if ( decoded ) {
+                    decoded[length++] = c;
+                }
+            }
+            pos_ += delimiter_size;
+
+            if ( decoded ) {
+                // hand back what the escapes didn't need, `decoded` is still the newest allocation
+                chunk_used_ -= capacity - length;
+            }
+
+            out.type = token_type::string;
+            out.text = decoded ? std::string_view( decoded, length ) : std::string_view( contents, raw_length );
+        }
+
+        void lex_number( token& out ) {
+            const char* s = source_.get();
+            std::size_t start = pos_;
+            std::size_t line_start = line_start_;
+
+            std::size_t hex = detail::match_any( s + pos_, Config::hex_prefixes );
+            std::size_t oct = detail::match_any( s + pos_, Config::oct_prefixes );
+            std::size_t bin = detail::match_any( s + pos_, Config::bin_prefixes );
+
+            int base = 10;
+            std::size_t prefix = 0;
+            if ( hex > oct && hex > bin ) {
+                base = 16;
+                prefix = hex;
+            } else if ( oct > hex && oct > bin ) {
+                base = 8;
+                prefix = oct;
+            } else if ( bin > hex && bin > oct ) {
+                base = 2;
+                prefix = bin;
+            } else if ( ( hex && ( hex == oct || hex == bin ) ) || ( oct && oct == bin ) ) {
+                fail( "integer literal prefix overlap" );
+            }
+
+            // a lone digit, e.g. `0` when "0" is an octal prefix
+            if ( !( tables::classes[(unsigned char)at( 1 )] & detail::CLASS_IDENT ) && at( 1 ) != '.' ) {
+                pos_ += 1;
+                out.type = token_type::integer;
+                out.i = (std::uint64_t)( s[start] - '0' );
+                return;
+            }
+
+            pos_ += prefix;
+            bool is_float = false;
+            for ( ;; pos_++ ) {
+                char c = at();
+                if ( base == 10 && c == '.' ) {
+                    if ( is_float ) fail( "multiple decimal points in number" );
+                    is_float = true;
+                } else if ( base == 10 && ( c == 'e' || c == 'E' ) ) {
+                    is_float = true;
+                    if ( at( 1 ) == '+' || at( 1 ) == '-' ) pos_ += 1;
+                } else {
+                    bool valid = base == 16 ? ( tables::classes[(unsigned char)c] & detail::CLASS_HEX_DIGIT ) != 0
+                        : base == 10 ? c >= '0' && c <= '9'
+                        : base == 8 ? c >= '0' && c <= '7'
+                        : c == '0' || c == '1';
+                    if ( !valid ) break;
+                }
+            }
+
+            std::size_t digits_end = pos_;
+            bool is_single = false;
+            if ( is_float ) {
+                std::size_t suffix = detail::match_any( s + pos_, Config::float_suffixes );
+                is_single = suffix != 0;
+                pos_ += suffix;
+            } else {
+                std::size_t hex_suffix = detail::match_any( s + pos_, Config::hex_suffixes );
+                std::size_t oct_suffix = detail::match_any( s + pos_, Config::oct_suffixes );
+                std::size_t bin_suffix = detail::match_any( s + pos_, Config::bin_suffixes );
+                std::size_t suffix = hex_suffix > oct_suffix && hex_suffix > bin_suffix ? ( base = 16, hex_suffix )
+                    : oct_suffix > hex_suffix && oct_suffix > bin_suffix ? ( base = 8, oct_suffix )
+                    : bin_suffix > hex_suffix && bin_suffix > oct_suffix ? ( base = 2, bin_suffix )
+                    : 0;
+                pos_ += suffix;
+            }
+
+            if ( tables::classes[(unsigned char)at()] & detail::CLASS_IDENT ) {
+                fail( "expected whitespace or punctuation to follow a number" );
+            }
+
+            std::size_t length = digits_end - start - prefix;
+            if ( length >= 128 ) {
+                throw error( "number literal too large", line_, start - line_start + 1 );
+            }
+
+            char buffer[128];
+            std::memcpy( buffer, s + start + prefix, length );
+            buffer[length] = '\0';
+
+            if ( is_single ) {
+                out.type = token_type::float_;
+                out.f = std::strtof( buffer, nullptr );
+            } else if ( is_float ) {
+                out.type = token_type::double_;
+                out.d = std::strtod( buffer, nullptr );
+            } else {
+                out.type = token_type::integer;
+                out.i = std::strtoull( buffer, nullptr, base );
+            }
+        }
+
+        // chunks never move once allocated
+        char* allocate( std::size_t size ) {
+            if ( chunks_.empty() || chunk_size_ - chunk_used_ < size ) {
+                chunk_size_ = size > LEXER_ARENA_CHUNK_SIZE ? size : LEXER_ARENA_CHUNK_SIZE;
+                chunks_.emplace_back( new char[chunk_size_] );
+                chunk_used_ = 0;
+            }
+            char* data = chunks_.back().get() + chunk_used_;
+            chunk_used_ += size;
+            return data;
+        }
+
+        std::unique_ptr<char[]> source_;
+        std::size_t size_ = 0;
+
+        std::size_t pos_ = 0;
+        std::size_t line_ = 1;
+        std::size_t line_start_ = 0;
+
+        std::vector<std::unique_ptr<char[]>> chunks_;
+        std::size_t chunk_size_ = 0;
+        std::size_t chunk_used_ = 0;
+    };
+
+#ifdef LEXER_OPERATOR_LIST
+    // c++ counterparts of the handlers `LEXER_ESCAPE_CHAR_LIST` refers to, looked up by the same name. a custom
+    // `LEXER_ESC_VARIABLE(c, fn)` or `LEXER_ESC_FALLBACK(fn)` needs an `escape_fn` called `fn` declared in this
+    // namespace before `lexer.hpp` is included
+    namespace escape_handlers {
+        constexpr escape_kind lexer_handle_hex_escape = escape_kind::hex;
+        constexpr escape_kind lexer_handle_unicode_escape16 = escape_kind::unicode16;
+        constexpr escape_kind lexer_handle_unicode_escape32 = escape_kind::unicode32;
+        constexpr escape_kind lexer_handle_octal_escape = escape_kind::octal;
+        constexpr escape_kind lexer_unhandled_escape = escape_kind::unhandled;
+    } // namespace escape_handlers
+
+    // the dialect configured in `lexer.def`
+    namespace def {
+        enum operator_type_t {
+        # define LEXER_OP(sym, name) name,
+            LEXER_OPERATOR_LIST
+        # undef LEXER_OP
+        };
+
+        enum punctuation_type_t {
+        # define LEXER_PUNCT(sym, name) name,
+            LEXER_PUNCTUATION_LIST
+        # undef LEXER_PUNCT
+        };
+
+        enum keyword_type_t {
+        # define LEXER_KEYWORD(sym, name) name,
+            LEXER_KEYWORD_LIST
+        # undef LEXER_KEYWORD
+        };
+    } // namespace def
+
+    struct def_config {
+        static constexpr std::string_view line_comment = LEXER_LINE_COMMENT_STRING;
+        static constexpr std::string_view multiline_comment_open = LEXER_MULTILINE_COMMENT_OPEN;
+        static constexpr std::string_view multiline_comment_close = LEXER_MULTILINE_COMMENT_CLOSE;
+
+        static constexpr bool multiline_strings = LEXER_SUPPORT_MULTILINE_STRINGS;
+        static constexpr std::string_view string_delimiters = LEXER_STRING_DELIMITERS;
+        static constexpr char char_delimiter = LEXER_CHAR_DELIMITER;
+        static constexpr char escape_char = LEXER_ESCAPE_CHAR;
+
+    # define LEXER_ESC_FIXED(c, value) escape { c, (std::uint32_t)( value ), escape_kind::fixed },
+    # define LEXER_ESC_VARIABLE(c, fn) detail::make_escape( c, escape_handlers::fn ),
+    # define LEXER_ESC_FALLBACK(fn)    detail::make_escape( '\0', escape_handlers::fn ),
+        static constexpr std::array escapes = { LEXER_ESCAPE_CHAR_LIST };
+    # undef LEXER_ESC_FIXED
+    # undef LEXER_ESC_VARIABLE
+    # undef LEXER_ESC_FALLBACK
+
+        static constexpr std::string_view hex_prefixes = LEXER_HEX_PREFIXES;
+        static constexpr std::string_view hex_suffixes = LEXER_HEX_SUFFIXES;
+        static constexpr std::string_view oct_prefixes = LEXER_OCT_PREFIXES;
+        static constexpr std::string_view oct_suffixes = LEXER_OCT_SUFFIXES;
+        static constexpr std::string_view bin_prefixes = LEXER_BIN_PREFIXES;
+        static constexpr std::string_view bin_suffixes = LEXER_BIN_SUFFIXES;
+        static constexpr std::string_view float_suffixes = LEXER_FLOAT_SUFFIXES;
+
+    # define LEXER_OP(sym, name) symbol { sym, def::name },
+        static constexpr std::array operators = { LEXER_OPERATOR_LIST };
+    # undef LEXER_OP
+
+    # define LEXER_PUNCT(sym, name) symbol { sym, def::name },
+        static constexpr std::array punctuation = { LEXER_PUNCTUATION_LIST };
+    # undef LEXER_PUNCT
+
+    # define LEXER_KEYWORD(sym, name) symbol { sym, def::name },
+        static constexpr std::array keywords = { LEXER_KEYWORD_LIST };
+    # undef LEXER_KEYWORD
+
+        // like `lexer.h`, which splits `integer` into `int` and `eger`
+        static constexpr bool keyword_prefixes = true;
+    };
+
+    using def_lexer = basic_lexer<def_config>;
+#endif // LEXER_OPERATOR_LIST
+
+} // namespace lexer
+
+#endif // LEXER_HPP
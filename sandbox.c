@@ -39,7 +39,7 @@ int main( void ) {
             break;
         case TOKEN_STRING:
             printf( "%14s", "string, " );
-            printf( "s: %5s, ", t->string->str );
+            printf( "s: %5.*s, ", (int)t->string.length, t->string.str );
             break;
         case TOKEN_DOUBLE:
             printf( "%14s", "double, " );
@@ -51,7 +51,7 @@ int main( void ) {
             break;
         case TOKEN_IDENTIFIER:
             printf( "%14s", "identifier, " );
-            printf( "x: %5s, ", t->string->str );
+            printf( "x: %5.*s, ", (int)t->string.length, t->string.str );
             break;
         }
         printf( "str: " );